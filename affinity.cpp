@@ -0,0 +1,200 @@
+#include "affinity.h"
+#include <dirent.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using std::vector;
+
+namespace ss {
+
+bool parse_cpu_list (const string& text, cpu_set_t& cpus) {
+
+	CPU_ZERO(&cpus);
+	const char* p = text.c_str();
+
+	while (*p != '\0') {
+
+		char* end = nullptr;
+		long first = strtol(p, &end, 10);
+		long last = first;
+
+		if (end == p || first < 0) {
+			return false;
+		}
+
+		if (*end == '-') {
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p || last < first) {
+				return false;
+			}
+		}
+
+		if (last >= CPU_SETSIZE) {
+			return false;
+		}
+
+		for (long cpu = first; cpu <= last; ++cpu) {
+			CPU_SET(cpu, &cpus);
+		}
+
+		if (*end == ',') {
+			++end;
+		} else if (*end != '\0' && *end != '\n') {
+			return false;
+		} else {
+			break;
+		}
+
+		p = end;
+	}
+
+	return CPU_COUNT(&cpus) > 0;
+
+}
+
+string format_cpu_list (const cpu_set_t& cpus) {
+
+	string list;
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+
+		if (!CPU_ISSET(cpu, &cpus)) {
+			continue;
+		}
+
+		int last = cpu;
+		while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpus)) {
+			++last;
+		}
+
+		list += (list.empty() ? "" : ",") + std::to_string(cpu);
+		if (last > cpu) {
+			list += "-" + std::to_string(last);
+		}
+
+		cpu = last;
+	}
+
+	return list;
+
+}
+
+/**
+* @return The CPUs the shell itself may run on, which bounds every job's set
+*/
+static cpu_set_t usable_cpus () {
+
+	cpu_set_t cpus;
+
+	if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(0, &cpus);
+	}
+
+	return cpus;
+
+}
+
+bool node_cpus (int node, cpu_set_t& cpus) {
+
+	std::ifstream list(("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist").c_str());
+	string text;
+
+	if (!std::getline(list, text) || !parse_cpu_list(text, cpus)) {
+		return false;
+	}
+
+	cpu_set_t usable = usable_cpus();
+	CPU_AND(&cpus, &cpus, &usable);
+	return CPU_COUNT(&cpus) > 0;
+
+}
+
+/**
+* @return The usable CPU sets of the NUMA nodes, or the usable CPUs as a single node without NUMA
+*/
+static vector<cpu_set_t> numa_nodes () {
+
+	vector<cpu_set_t> nodes;
+	DIR* dir = opendir("/sys/devices/system/node");
+	struct dirent* entry;
+
+	while (dir != nullptr && (entry = readdir(dir)) != nullptr) {
+
+		char* end = nullptr;
+		long node = strncmp(entry -> d_name, "node", 4) == 0 ? strtol(entry -> d_name + 4, &end, 10) : -1;
+		cpu_set_t cpus;
+
+		if (node >= 0 && *end == '\0' && node_cpus(node, cpus)) {
+			nodes.push_back(cpus);
+		}
+	}
+
+	if (dir != nullptr) {
+		closedir(dir);
+	}
+
+	if (nodes.empty()) {
+		nodes.push_back(usable_cpus());
+	}
+
+	return nodes;
+
+}
+
+void spread_cpus (bool by_node, const job_table& jobs, cpu_set_t& cpus) {
+
+	static size_t next_core = 0, next_node = 0; // where the round-robin resumes
+
+	vector<cpu_set_t> candidates;
+
+	if (by_node) {
+		candidates = numa_nodes();
+	} else {
+		cpu_set_t usable = usable_cpus();
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if (CPU_ISSET(cpu, &usable)) {
+				cpu_set_t core;
+				CPU_ZERO(&core);
+				CPU_SET(cpu, &core);
+				candidates.push_back(core);
+			}
+		}
+	}
+
+	vector<unsigned> load(candidates.size(), 0);
+
+	for (job_table::const_iterator job = jobs.cbegin(); job != jobs.cend(); job++) {
+
+		if (job -> reaped || !job -> pinned) {
+			continue;
+		}
+
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			cpu_set_t shared;
+			CPU_AND(&shared, &candidates[i], &job -> cpus);
+			if (CPU_COUNT(&shared) > 0) {
+				load[i]++;
+			}
+		}
+	}
+
+	size_t& next = by_node ? next_node : next_core;
+	size_t best = next % candidates.size();
+
+	for (size_t k = 1; k < candidates.size(); ++k) {
+		size_t i = (next + k) % candidates.size();
+		if (load[i] < load[best]) {
+			best = i;
+		}
+	}
+
+	next = best + 1;
+	cpus = candidates[best];
+
+}
+
+}
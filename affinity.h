@@ -0,0 +1,46 @@
+#ifndef _AFFINITY_H_
+#define _AFFINITY_H_
+
+#include <sched.h>
+#include <string>
+
+#include "jobs.h"
+
+using std::string;
+
+namespace ss {
+
+/**
+* Parse a CPU list in the kernel's cpulist format, e.g. 0-7,16-23
+* @param text The list
+* @param cpus Receives the CPUs
+* @return false if the list is malformed or names a CPU beyond CPU_SETSIZE
+*/
+bool parse_cpu_list (const string& text, cpu_set_t& cpus);
+
+/**
+* Format a CPU set in the cpulist format
+*/
+string format_cpu_list (const cpu_set_t& cpus);
+
+/**
+* Find the CPUs of a NUMA node that the shell may run on
+* @param node The node number
+* @param cpus Receives the CPUs
+* @return false if there is no such node, or none of its CPUs is usable
+*/
+bool node_cpus (int node, cpu_set_t& cpus);
+
+/**
+* Pick where the next job runs, away from the jobs in ps that are still running pinned.
+* Each candidate, a core or a NUMA node, is scored by the number of live pinned jobs allowed on it;
+* the least loaded wins, and ties go round-robin so successive jobs land on successive candidates
+* @param by_node Spread over NUMA nodes rather than single cores
+* @param jobs The job table to balance against
+* @param cpus Receives the CPUs of the chosen core or node
+*/
+void spread_cpus (bool by_node, const job_table& jobs, cpu_set_t& cpus);
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "arena.h"
+#include <cstring>
+
+namespace ss {
+
+arena::arena (size_t block_size) : current(0), used(0), block_size(block_size) {
+}
+
+arena::~arena () {
+
+	for (std::vector<block>::iterator iter = blocks.begin(); iter != blocks.end(); iter++) {
+		delete[] iter -> data;
+	}
+
+}
+
+char* arena::allocate (size_t n) {
+
+	// move on to a later block that still has room
+	while (current < blocks.size() && blocks[current].size - used < n) {
+		++current;
+		used = 0;
+	}
+
+	if (current == blocks.size()) {
+		block fresh;
+		fresh.size = n > block_size ? n : block_size;
+		fresh.data = new char[fresh.size];
+		blocks.push_back(fresh);
+		used = 0;
+	}
+
+	char* p = blocks[current].data + used;
+	used += n;
+	return p;
+
+}
+
+char* arena::grow (char* p, size_t old_size, size_t new_size) {
+
+	if (current < blocks.size() && p + old_size == blocks[current].data + used
+	    && blocks[current].size - used >= new_size - old_size) { // nothing was allocated after p
+		used += new_size - old_size;
+		return p;
+	}
+
+	char* fresh = allocate(new_size);
+	memcpy(fresh, p, old_size);
+	return fresh;
+
+}
+
+void arena::clear () {
+
+	current = 0;
+	used = 0;
+
+}
+
+}
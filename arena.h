@@ -0,0 +1,62 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace ss {
+
+/**
+* A bump allocator handing out memory from a list of blocks.
+* Blocks are never moved, so pointers into the arena stay valid until clear,
+* and clear keeps the blocks for reuse by the next command
+*/
+class arena {
+
+public:
+	/**
+	* @param block_size Size of each block; larger requests get a block of their own
+	*/
+	explicit arena (size_t block_size = 64 * 1024);
+	~arena ();
+
+	arena (const arena&) = delete;
+	arena& operator= (const arena&) = delete;
+
+	/**
+	* @param n Number of bytes to allocate
+	* @return Uninitialized memory valid until clear or destruction
+	*/
+	char* allocate (size_t n);
+
+	/**
+	* Enlarge the most recent allocation, in place if its block has room.
+	* Growing geometrically keeps the total copying linear in the final size
+	* @param p The most recent allocation
+	* @param old_size Its size
+	* @param new_size The size wanted, larger than old_size
+	* @return The allocation, moved if it did not fit, with its first old_size bytes kept
+	*/
+	char* grow (char* p, size_t old_size, size_t new_size);
+
+	/**
+	* Release every allocation at once, keeping the blocks
+	*/
+	void clear ();
+
+private:
+	struct block {
+		char* data;
+		size_t size;
+	};
+
+	std::vector<block> blocks;
+	size_t current; // index of the block being filled
+	size_t used;    // bytes used in the current block
+	size_t block_size;
+
+};
+
+}
+
+#endif
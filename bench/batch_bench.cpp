@@ -0,0 +1,81 @@
+/**
+* Runs a generated command file through the shell in batch mode and compares
+* its rate with launching the same commands directly through the spawn engine,
+* which is the upper bound for the shell.
+* Usage: batch_bench [lines] [shell]
+*/
+#include "spawn.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+/**
+* Run a command to completion with its output sent to /dev/null
+*/
+static void run_quietly (vector<string>& tokens) {
+
+	ss::spawn_plan plan;
+	ss::make_plan(tokens, plan);
+
+	static int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	ss::fd_action quiet = { STDOUT_FILENO, null_fd };
+	plan.actions.push_back(quiet);
+	quiet.fd = STDERR_FILENO;
+	plan.actions.push_back(quiet);
+
+	sigset_t orig_mask;
+	ss::block_sigchld(orig_mask);
+	pid_t child = ss::spawn(plan, orig_mask);
+	ss::restore_sigmask(orig_mask);
+
+	if (child > 0) {
+		waitpid(child, nullptr, 0);
+	}
+
+}
+
+int main (int argc, char* argv[]) {
+
+	int lines = argc > 1 ? atoi(argv[1]) : 100000;
+	string shell = argc > 2 ? argv[2] : "./main";
+	string script = "/tmp/ss_batch_bench." + std::to_string(getpid()) + ".ss";
+
+	std::ofstream out(script.c_str());
+	for (int i = 0; i < lines; ++i) {
+		out << "ls -d /\n";
+	}
+	out.close();
+
+	const char* words[] = { "ls", "-d", "/" };
+	vector<string> command(words, words + 3);
+
+	double start = ss::monotonic_now();
+	for (int i = 0; i < lines; ++i) {
+		run_quietly(command);
+	}
+	double direct = ss::monotonic_now() - start;
+
+	vector<string> batch;
+	batch.push_back(shell);
+	batch.push_back(script);
+
+	start = ss::monotonic_now();
+	run_quietly(batch);
+	double scripted = ss::monotonic_now() - start;
+
+	unlink(script.c_str());
+
+	cout << "{\"bench\": \"batch\", \"lines\": " << lines
+	     << ", \"shell_lines_per_sec\": " << lines / scripted
+	     << ", \"spawn_bound_per_sec\": " << lines / direct << "}" << endl;
+
+	return 0;
+}
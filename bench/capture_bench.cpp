@@ -0,0 +1,64 @@
+/**
+* A background job writing as fast as it can into a captured ring: the shell must drain it
+* at pipe speed while its own memory stays flat, whatever the job writes.
+* Reports the drain rate and the shell's peak RSS.
+* Usage: capture_bench [megabytes] [shell]
+*/
+#include "reaper.h"
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using std::cout;
+using std::endl;
+using std::string;
+
+/**
+* Run a script in the shell
+* @return The shell's peak RSS in kB
+*/
+static long run_script (const string& shell, const string& script) {
+
+	pid_t child = fork();
+
+	if (child == 0) {
+		execl(shell.c_str(), shell.c_str(), script.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	int status = 0;
+	struct rusage usage;
+	wait4(child, &status, 0, &usage);
+	return usage.ru_maxrss;
+
+}
+
+int main (int argc, char* argv[]) {
+
+	long megabytes = argc > 1 ? atol(argv[1]) : 1024;
+	string shell = argc > 2 ? argv[2] : "./main";
+	string script = "/tmp/ss_capture_bench." + std::to_string(getpid()) + ".ss";
+	string bytes = std::to_string(megabytes << 20);
+
+	// the same job without capture, for the shell's baseline RSS
+	std::ofstream(script.c_str()) << "bg --restart=never head -c 1 /dev/zero\nwait\n";
+	long baseline_rss = run_script(shell, script);
+
+	std::ofstream(script.c_str()) << "bg --capture=64K --restart=never head -c " << bytes << " /dev/zero\nwait\n";
+	double start = ss::monotonic_now();
+	long rss = run_script(shell, script);
+	double elapsed = ss::monotonic_now() - start;
+
+	unlink(script.c_str());
+
+	cout << "{\"bench\": \"capture\", \"megabytes\": " << megabytes << ", \"seconds\": " << elapsed
+	     << ", \"mb_per_s\": " << megabytes / elapsed << ", \"shell_rss_kb\": " << rss
+	     << ", \"baseline_rss_kb\": " << baseline_rss << "}" << endl;
+
+	return 0;
+}
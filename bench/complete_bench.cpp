@@ -0,0 +1,70 @@
+/**
+* Command completion over a PATH holding thousands of executables: the first completion
+* builds the trie, later ones only stat each PATH directory, and adding one program
+* rescans just the directory it was added to.
+* Usage: complete_bench [executables]
+*/
+#include "complete.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+int main (int argc, char* argv[]) {
+
+	long count = argc > 1 ? atol(argv[1]) : 5000;
+	string dir = "/tmp/ss_complete_bench." + std::to_string(getpid());
+	mkdir(dir.c_str(), 0755);
+
+	const char* stems[] = { "git-", "gcc-", "python-", "perl-", "zz-tool-" };
+	for (long i = 0; i < count; ++i) {
+		string path = dir + "/" + stems[i % 5] + std::to_string(i);
+		close(open(path.c_str(), O_CREAT | O_WRONLY, 0755));
+	}
+
+	string path = dir + ":" + (getenv("PATH") != nullptr ? getenv("PATH") : "/usr/bin");
+	setenv("PATH", path.c_str(), 1);
+
+	vector<string> matches;
+	double start = ss::monotonic_now();
+	ss::complete_command("git-", matches);
+	double build = ss::monotonic_now() - start;
+
+	const int lookups = 1000;
+	size_t found = 0;
+	start = ss::monotonic_now();
+	for (int i = 0; i < lookups; ++i) {
+		matches.clear();
+		ss::complete_command("zz-tool-49", matches);
+		found = matches.size();
+	}
+	double lookup = (ss::monotonic_now() - start) / lookups;
+
+	// a new program only shows up once its directory is rescanned
+	string added = dir + "/zz-tool-new";
+	close(open(added.c_str(), O_CREAT | O_WRONLY, 0755));
+	matches.clear();
+	start = ss::monotonic_now();
+	ss::complete_command("zz-tool-new", matches);
+	double rescan = ss::monotonic_now() - start;
+	size_t added_found = matches.size();
+
+	for (long i = 0; i < count; ++i) {
+		unlink((dir + "/" + stems[i % 5] + std::to_string(i)).c_str());
+	}
+	unlink(added.c_str());
+	rmdir(dir.c_str());
+
+	cout << "{\"bench\": \"complete\", \"executables\": " << count
+	     << ", \"build_s\": " << build
+	     << ", \"lookup_s\": " << lookup << ", \"lookup_found\": " << found
+	     << ", \"rescan_s\": " << rescan << ", \"rescan_found\": " << added_found << "}" << endl;
+
+	return 0;
+}
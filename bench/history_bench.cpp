@@ -0,0 +1,69 @@
+/**
+* Opening and searching a large persistent history: the first open indexes the whole log,
+* later opens only map it, and searches skip blocks by their trigram filters.
+* Usage: history_bench [entries]
+*/
+#include "histlog.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+int main (int argc, char* argv[]) {
+
+	long entries = argc > 1 ? atol(argv[1]) : 1000000;
+	string path = "/tmp/ss_history_bench." + std::to_string(getpid());
+
+	std::ofstream out(path.c_str());
+	const char* commands[] = { "ls -l /var/log", "cd /srv/data/batch", "query", "bg --restart=failure worker --shard",
+	                           "parallel -j 8 gzip -a files", "stats --json /tmp/stats" };
+	for (long i = 0; i < entries; ++i) {
+		if (i == 17) {
+			out << "rare-entry-marker\n";
+		} else {
+			out << commands[i % 6] << " " << i << "\n";
+		}
+	}
+	out << "make bench needle\n"; // the newest entry
+	out.close();
+
+	double start = ss::monotonic_now();
+	ss::history_open(path);
+	double build = ss::monotonic_now() - start;
+	ss::history_close();
+
+	start = ss::monotonic_now();
+	ss::history_open(path);
+	double reopen = ss::monotonic_now() - start;
+
+	// only entry 17 contains this text, so all but one block are rejected by their filters
+	start = ss::monotonic_now();
+	long rare = ss::history_search("rare-entry", false, ss::history_size());
+	double rare_time = ss::monotonic_now() - start;
+
+	start = ss::monotonic_now();
+	long recent = ss::history_search("needle", false, ss::history_size());
+	double recent_time = ss::monotonic_now() - start;
+
+	start = ss::monotonic_now();
+	long prefix = ss::history_search("cd /srv/data/batch 99", true, ss::history_size());
+	double prefix_time = ss::monotonic_now() - start;
+
+	ss::history_close();
+	unlink(path.c_str());
+	unlink((path + ".idx").c_str());
+
+	cout << "{\"bench\": \"history\", \"entries\": " << entries + 1
+	     << ", \"index_build_s\": " << build
+	     << ", \"open_s\": " << reopen
+	     << ", \"rare_search_s\": " << rare_time << ", \"rare_found\": " << rare
+	     << ", \"recent_search_s\": " << recent_time << ", \"recent_found\": " << recent
+	     << ", \"prefix_search_s\": " << prefix_time << ", \"prefix_found\": " << prefix << "}" << endl;
+
+	return 0;
+}
@@ -0,0 +1,107 @@
+/**
+* How fast an external monitor can poll the shared-memory job table while the shell
+* is busy launching and reaping jobs. The shell runs more background jobs than the table
+* starts with, so the reader also has to follow the segment as it grows.
+* Usage: jobshm_bench [jobs] [shell]
+*/
+#include "ss_jobshm.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using std::cout;
+using std::endl;
+using std::string;
+
+int main (int argc, char* argv[]) {
+
+	int jobs = argc > 1 ? atoi(argv[1]) : 2000;
+	string shell = argc > 2 ? argv[2] : "./main";
+	string script = "/tmp/ss_jobshm_bench." + std::to_string(getpid()) + ".ss";
+
+	std::ofstream out(script.c_str());
+	for (int i = 0; i < jobs; ++i) {
+		out << "bg --restart=never sleep " << (i % 2 == 0 ? "0.01" : "1") << "\n";
+	}
+	out << "wait\n";
+	out.close();
+
+	pid_t child = fork();
+
+	if (child == 0) {
+		execl(shell.c_str(), shell.c_str(), script.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	string path = "/dev/shm/" SS_JOBSHM_PREFIX + std::to_string(child);
+	int fd = -1;
+
+	while ((fd = open(path.c_str(), O_RDONLY)) == -1 && waitpid(child, nullptr, WNOHANG) == 0) {
+		usleep(100);
+	}
+
+	void* mapped = MAP_FAILED;
+	size_t mapped_size = 0;
+	long polls = 0, records = 0, retries = 0, remaps = 0;
+	uint32_t most = 0;
+	double start = ss::monotonic_now();
+
+	while (fd != -1 && waitpid(child, nullptr, WNOHANG) == 0) {
+
+		struct stat st;
+		fstat(fd, &st);
+
+		if (size_t(st.st_size) != mapped_size) { // the table grew
+			if (mapped != MAP_FAILED) {
+				munmap(mapped, mapped_size);
+			}
+			mapped_size = st.st_size;
+			mapped = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+			remaps++;
+		}
+
+		const ss_jobshm_header* header = static_cast<const ss_jobshm_header*>(mapped);
+
+		if (mapped == MAP_FAILED || __atomic_load_n(&header -> magic, __ATOMIC_ACQUIRE) != SS_JOBSHM_MAGIC) {
+			continue;
+		}
+
+		const ss_jobshm_record* table = reinterpret_cast<const ss_jobshm_record*>(header + 1);
+		uint32_t used = __atomic_load_n(&header -> used, __ATOMIC_ACQUIRE);
+		uint32_t fit = (mapped_size - sizeof(ss_jobshm_header)) / sizeof(ss_jobshm_record);
+
+		for (uint32_t i = 0; i < used && i < fit; ++i) {
+			ss_jobshm_record r;
+			if (ss_jobshm_read(&table[i], &r) != 0) {
+				retries++;
+			} else if (r.pid != 0) {
+				records++;
+			}
+		}
+
+		most = std::max(most, used);
+		polls++;
+	}
+
+	double elapsed = ss::monotonic_now() - start;
+
+	if (fd != -1) {
+		close(fd);
+	}
+	unlink(script.c_str());
+
+	cout << "{\"bench\": \"jobshm\", \"jobs\": " << jobs << ", \"polls\": " << polls
+	     << ", \"polls_per_s\": " << polls / elapsed << ", \"records_read\": " << records
+	     << ", \"torn_reads\": " << retries << ", \"max_records\": " << most << ", \"remaps\": " << remaps << "}" << endl;
+
+	return 0;
+}
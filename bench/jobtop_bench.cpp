@@ -0,0 +1,85 @@
+/**
+* Cost of a jobtop refresh over thousands of live jobs: the first sample opens every
+* /proc/<pid>/stat, later ones pread the kept descriptors. Reopening the files on every
+* refresh, as query does for a single job, is timed for comparison.
+* Usage: jobtop_bench [jobs]
+*/
+#include "jobtop.h"
+#include "cmds.h"
+#include "procstat.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+int main (int argc, char* argv[]) {
+
+	long jobs = argc > 1 ? atol(argv[1]) : 5000;
+
+	struct rlimit rl;
+	getrlimit(RLIMIT_NOFILE, &rl);
+	rl.rlim_cur = rl.rlim_max; // room to keep a descriptor per job
+	setrlimit(RLIMIT_NOFILE, &rl);
+
+	vector<pid_t> children;
+	vector<string> command(1, "pause");
+
+	for (long i = 0; i < jobs; ++i) {
+
+		pid_t child = fork();
+
+		if (child == 0) {
+			pause();
+			_exit(0);
+		}
+
+		if (child > 0) {
+			children.push_back(child);
+			ss::add_process(child, command, false);
+		}
+	}
+
+	vector<ss::job_sample> samples;
+
+	double start = ss::monotonic_now();
+	size_t opened = ss::sample_jobs(samples);
+	double first = ss::monotonic_now() - start;
+
+	const int refreshes = 10;
+	start = ss::monotonic_now();
+	size_t reopened = 0;
+	for (int i = 0; i < refreshes; ++i) {
+		reopened += ss::sample_jobs(samples);
+	}
+	double kept = (ss::monotonic_now() - start) / refreshes;
+
+	start = ss::monotonic_now();
+	for (int i = 0; i < refreshes; ++i) {
+		ss::proc_stat st;
+		for (vector<pid_t>::const_iterator pid = children.cbegin(); pid != children.cend(); pid++) {
+			ss::read_proc_stat(*pid, st);
+		}
+	}
+	double reopen = (ss::monotonic_now() - start) / refreshes;
+
+	ss::stop_sampling();
+
+	for (vector<pid_t>::const_iterator pid = children.cbegin(); pid != children.cend(); pid++) {
+		kill(*pid, SIGKILL);
+		waitpid(*pid, nullptr, 0);
+	}
+
+	// at 1 Hz the share of a core is the time of one refresh in seconds
+	cout << "{\"bench\": \"jobtop\", \"jobs\": " << children.size() << ", \"sampled\": " << samples.size()
+	     << ", \"first_sample_s\": " << first << ", \"files_opened\": " << opened
+	     << ", \"refresh_s\": " << kept << ", \"files_reopened\": " << reopened / refreshes
+	     << ", \"reopen_refresh_s\": " << reopen << ", \"core_share_at_1hz\": " << kept << "}" << endl;
+
+	return 0;
+}
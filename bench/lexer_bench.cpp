@@ -0,0 +1,89 @@
+/**
+* Throughput of ss::lex against the find/erase tokenizer it replaced,
+* on generated command lines mixing plain, quoted and escaped words.
+* Usage: lexer_bench [megabytes]
+*/
+#include "lexer.h"
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+static double now () {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+/**
+* The tokenizer simple_shell used before the lexer
+*/
+static void legacy_tokenize (string& src, string delim, vector<string>& dst) {
+
+	size_t pos = 0;
+	string token;
+
+	while ((pos = src.find(delim)) != std::string::npos) {
+		token = src.substr(0, pos);
+		if (!token.empty()) {
+			dst.push_back(token);
+		}
+		src.erase(0, pos + delim.length());
+	}
+
+	if (!src.empty()) {
+		dst.push_back(src);
+	}
+
+}
+
+static string generate_line (size_t bytes) {
+
+	static const char* samples[] = {
+		"ls", "-la", "/usr/local/share/doc", "\"quoted argument\"", "'single quoted'",
+		"escaped\\ space", "--option=value", "  ", "file_0123456789.txt", "\t"
+	};
+
+	string line;
+	line.reserve(bytes + 64);
+
+	for (unsigned i = 0; line.size() < bytes; ++i) {
+		line += samples[(i * 7) % 10];
+		line += ' ';
+	}
+
+	return line;
+
+}
+
+int main (int argc, char* argv[]) {
+
+	size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16;
+	string line = generate_line(megabytes << 20);
+
+	ss::arena scratch;
+	vector<ss::word> words;
+
+	double start = now();
+	ss::lex(line.data(), line.size(), words, scratch);
+	double lexed = now() - start;
+
+	// the legacy tokenizer is quadratic, so it only gets a small prefix of the line
+	string prefix = line.substr(0, 256 << 10);
+	vector<string> tokens;
+
+	start = now();
+	legacy_tokenize(prefix, " ", tokens);
+	double legacy = now() - start;
+
+	cout << "{\"bench\": \"lexer\", \"bytes\": " << line.size() << ", \"words\": " << words.size()
+	     << ", \"lexer_mb_per_sec\": " << (line.size() / 1048576.0) / lexed
+	     << ", \"legacy_bytes\": " << (256 << 10)
+	     << ", \"legacy_mb_per_sec\": " << 0.25 / legacy << "}" << endl;
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+/**
+* A million iterations of a while loop of builtins, bench/loop.ss: the loop is compiled
+* once, so each iteration costs word expansion and a builtin call, without lexing.
+* The same script is timed in /bin/sh for reference.
+* Usage: loop_bench [script] [shell]
+*/
+#include "reaper.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using std::cout;
+using std::endl;
+using std::string;
+
+/**
+* Run a script in a shell, discarding its output
+* @return The wall time in seconds, or -1 if the shell failed
+*/
+static double run_script (const string& shell, const string& script) {
+
+	double start = ss::monotonic_now();
+	pid_t child = fork();
+
+	if (child == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		execl(shell.c_str(), shell.c_str(), script.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	double elapsed = ss::monotonic_now() - start;
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : -1;
+
+}
+
+int main (int argc, char* argv[]) {
+
+	string script = argc > 1 ? argv[1] : "bench/loop.ss";
+	string shell = argc > 2 ? argv[2] : "./main";
+	const long iterations = 1000000; // n in bench/loop.ss
+
+	double seconds = run_script(shell, script);
+	double sh_seconds = access("/bin/sh", X_OK) == 0 ? run_script("/bin/sh", script) : -1;
+
+	cout << "{\"bench\": \"loop\", \"iterations\": " << iterations << ", \"seconds\": " << seconds
+	     << ", \"ns_per_iteration\": " << seconds * 1e9 / iterations << ", \"sh_seconds\": " << sh_seconds << "}" << endl;
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/**
+* The in-process ls against the external ls launched through the spawn engine,
+* both listing a generated directory with output sent to /dev/null.
+* Usage: ls_bench [entries]
+*/
+#include "ls.h"
+#include "spawn.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+
+using std::cout;
+using std::endl;
+
+/**
+* Best of this many runs of each listing
+*/
+static const int rounds = 3;
+
+static double run_native (vector<string>& tokens, int null_fd) {
+
+	int saved = dup(STDOUT_FILENO);
+	dup2(null_fd, STDOUT_FILENO);
+
+	double start = ss::monotonic_now();
+	ss::ls(tokens, true);
+	double elapsed = ss::monotonic_now() - start;
+
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	return elapsed;
+
+}
+
+static double run_external (vector<string>& tokens, int null_fd) {
+
+	ss::spawn_plan plan;
+	ss::make_plan(tokens, plan);
+
+	ss::fd_action quiet = { STDOUT_FILENO, null_fd };
+	plan.actions.push_back(quiet);
+
+	sigset_t orig_mask;
+	ss::block_sigchld(orig_mask);
+
+	double start = ss::monotonic_now();
+	pid_t child = ss::spawn(plan, orig_mask);
+
+	if (child > 0) {
+		waitpid(child, nullptr, 0);
+	}
+
+	double elapsed = ss::monotonic_now() - start;
+	ss::restore_sigmask(orig_mask);
+
+	return elapsed;
+
+}
+
+int main (int argc, char* argv[]) {
+
+	long entries = argc > 1 ? atol(argv[1]) : 1000000;
+
+	char dir_path[] = "/tmp/ss_ls_bench.XXXXXX";
+
+	if (mkdtemp(dir_path) == nullptr) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	int dir = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	char name[32];
+
+	for (long i = 0; i < entries; ++i) {
+		snprintf(name, sizeof(name), "f%ld", (i * 7919) % entries); // not created in sorted order
+		int fd = openat(dir, name, O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+		if (fd == -1) {
+			perror("openat");
+			return 1;
+		}
+		close(fd);
+	}
+
+	int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+	vector<string> tokens;
+	tokens.push_back("ls");
+	tokens.push_back("-1");
+	tokens.push_back(dir_path);
+
+	double native = 1e9, external = 1e9;
+
+	for (int i = 0; i < rounds; ++i) {
+		native = std::min(native, run_native(tokens, null_fd));
+		external = std::min(external, run_external(tokens, null_fd));
+	}
+
+	for (long i = 0; i < entries; ++i) {
+		snprintf(name, sizeof(name), "f%ld", i);
+		unlinkat(dir, name, 0);
+	}
+
+	close(dir);
+	rmdir(dir_path);
+
+	cout << "{\"bench\": \"ls\", \"entries\": " << entries
+	     << ", \"native_s\": " << native
+	     << ", \"external_s\": " << external
+	     << ", \"speedup\": " << external / native << "}" << endl;
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+/**
+* Throughput of a 4-stage pipeline whose middle stages are the built-in splice stage,
+* against the same pipeline with cat copying through user space.
+* Usage: pipeline_bench [gigabytes]
+*/
+#include "cmds.h"
+#include "reaper.h"
+#include "pipeline.h"
+#include <cstdlib>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+/**
+* Run source | middle | middle | wc -c in the foreground
+* @return Seconds taken
+*/
+static double run (const string& bytes, const string& middle) {
+
+	const char* words[] = { "head", "-c", bytes.c_str(), "/dev/zero", "|", middle.c_str(), "|", middle.c_str(),
+	                        "|", "wc", "-c", ">", "/dev/null" };
+	vector<string> tokens(words, words + sizeof(words) / sizeof(words[0]));
+
+	double start = ss::monotonic_now();
+	ss::run_pipeline(tokens, ss::find_pipes(tokens), true);
+	return ss::monotonic_now() - start;
+
+}
+
+int main (int argc, char* argv[]) {
+
+	double gigabytes = argc > 1 ? atof(argv[1]) : 4;
+	string bytes = std::to_string(static_cast<long long>(gigabytes * (1 << 30)));
+
+	ss::reaper_initialize();
+	ss::reset_options();
+
+	double spliced = run(bytes, "tee");
+	double copied = run(bytes, "cat");
+
+	cout << "{\"bench\": \"pipeline\", \"stages\": 4, \"bytes\": " << bytes
+	     << ", \"splice_gb_per_sec\": " << gigabytes / spliced
+	     << ", \"cat_gb_per_sec\": " << gigabytes / copied << "}" << endl;
+
+	return 0;
+}
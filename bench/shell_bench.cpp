@@ -0,0 +1,230 @@
+/**
+* End-to-end latency of the shell, driven through a pseudo-terminal the way a user drives it:
+* prompt-to-prompt latency of a builtin, the rate of ls in-process and spawned, the time to
+* launch and reap many background jobs, line throughput for long lines, and the CPU the shell
+* burns while waiting on a foreground job.
+* Usage: shell_bench [background jobs] [shell]
+*/
+#include "reaper.h"
+#include <pty.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+/**
+* The pty master and what the shell printed since the last command
+*/
+static int master = -1;
+static string output;
+
+/**
+* The prompt the shell prints when it is ready for the next line
+*/
+static string prompt;
+
+/**
+* Read from the shell until it prints its prompt
+* @return false if the shell exited or stayed silent for too long
+*/
+static bool wait_prompt () {
+
+	double deadline = ss::monotonic_now() + 60;
+
+	while (output.find(prompt) == string::npos) {
+
+		struct pollfd p = { master, POLLIN, 0 };
+
+		if (poll(&p, 1, 1000) < 0 && errno != EINTR) {
+			return false;
+		}
+
+		char buf[65536];
+		ssize_t n = read(master, buf, sizeof(buf));
+
+		if (n > 0) {
+			output.append(buf, n);
+		} else if (n == 0 || (errno != EAGAIN && errno != EINTR) || ss::monotonic_now() > deadline) {
+			return false;
+		}
+	}
+
+	output.clear();
+	return true;
+
+}
+
+/**
+* Type a line and wait for the next prompt. The echo is drained while writing,
+* so a long line cannot fill the pty in both directions
+* @return Seconds from the first byte written to the prompt, or -1 on failure
+*/
+static double run_line (const string& line) {
+
+	string text = line + "\r";
+	size_t written = 0;
+	double start = ss::monotonic_now();
+
+	while (written < text.size()) {
+
+		ssize_t n = write(master, text.data() + written, text.size() - written);
+
+		if (n > 0) {
+			written += n;
+			continue;
+		}
+
+		if (n < 0 && errno != EAGAIN && errno != EINTR) {
+			return -1;
+		}
+
+		struct pollfd p = { master, POLLIN | POLLOUT, 0 };
+		poll(&p, 1, 1000);
+
+		char buf[65536];
+		ssize_t r = read(master, buf, sizeof(buf));
+		if (r > 0) {
+			output.append(buf, r);
+		}
+	}
+
+	return wait_prompt() ? ss::monotonic_now() - start : -1;
+
+}
+
+/**
+* @return The user plus system CPU seconds used by a process so far
+*/
+static double cpu_seconds (pid_t pid) {
+
+	std::ifstream stat(("/proc/" + std::to_string(pid) + "/stat").c_str());
+	string content((std::istreambuf_iterator<char>(stat)), std::istreambuf_iterator<char>());
+	size_t fields = content.rfind(')');
+
+	if (fields == string::npos) {
+		return 0;
+	}
+
+	// utime and stime are the 12th and 13th fields after the command name
+	unsigned long utime = 0, stime = 0;
+	sscanf(content.c_str() + fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime);
+	return double(utime + stime) / sysconf(_SC_CLK_TCK);
+
+}
+
+static double percentile (vector<double> samples, double p) {
+
+	std::sort(samples.begin(), samples.end());
+	return samples.empty() ? 0 : samples[std::min(samples.size() - 1, size_t(p * samples.size()))];
+
+}
+
+int main (int argc, char* argv[]) {
+
+	int jobs = argc > 1 ? atoi(argv[1]) : 10000;
+	string shell = argc > 2 ? argv[2] : "./main";
+
+	char cwd[4096];
+	if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+		return 1;
+	}
+	prompt = string("Simple_Shell:") + cwd + "$ ";
+
+	struct winsize size = { 50, 200, 0, 0 };
+	pid_t shell_pid = forkpty(&master, nullptr, nullptr, &size);
+
+	if (shell_pid < 0) {
+		perror("forkpty");
+		return 1;
+	}
+
+	if (shell_pid == 0) {
+		setenv("SS_HISTFILE", "", 1); // leave the user's history alone
+		setenv("TERM", "dumb", 1);
+		execl(shell.c_str(), shell.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+	if (!wait_prompt()) {
+		std::cerr << "shell_bench: no prompt from " << shell << endl;
+		return 1;
+	}
+
+	// prompt to prompt for a builtin that prints nothing
+	const int builtin_runs = 2000;
+	vector<double> builtin;
+	for (int i = 0; i < builtin_runs; ++i) {
+		builtin.push_back(run_line("cd ."));
+	}
+
+	// ls in-process, then the same listing through fork and exec
+	const int ls_runs = 500;
+	double start = ss::monotonic_now();
+	for (int i = 0; i < ls_runs; ++i) {
+		run_line("ls -1 /");
+	}
+	double ls_builtin = ss::monotonic_now() - start;
+
+	start = ss::monotonic_now();
+	for (int i = 0; i < ls_runs; ++i) {
+		run_line("/bin/ls -1 /");
+	}
+	double ls_spawned = ss::monotonic_now() - start;
+
+	// many background jobs, then the wait until every one is reaped
+	run_line("retain " + std::to_string(jobs));
+	start = ss::monotonic_now();
+	for (int i = 0; i < jobs; ++i) {
+		run_line("bg --restart=never true");
+	}
+	double launch = ss::monotonic_now() - start;
+	double reap = run_line("wait");
+
+	// long lines of quoted and escaped words; cd rejects them after they are tokenized
+	string words = "cd";
+	while (words.size() < 4000) {
+		words += " plain \"double quoted\" 'single quoted' escaped\\ space";
+	}
+	const int long_runs = 200;
+	start = ss::monotonic_now();
+	for (int i = 0; i < long_runs; ++i) {
+		run_line(words);
+	}
+	double long_lines = ss::monotonic_now() - start;
+
+	// the shell should sleep in poll while a foreground job runs
+	double cpu_before = cpu_seconds(shell_pid);
+	double idle_wall = run_line("sleep 2");
+	double idle_cpu = cpu_seconds(shell_pid) - cpu_before;
+
+	run_line("exit");
+	kill(shell_pid, SIGHUP);
+	waitpid(shell_pid, nullptr, 0);
+
+	cout << "{\"bench\": \"shell\", \"builtin_runs\": " << builtin_runs
+	     << ", \"builtin_p50_s\": " << percentile(builtin, 0.5)
+	     << ", \"builtin_p99_s\": " << percentile(builtin, 0.99)
+	     << ", \"ls_builtin_per_s\": " << ls_runs / ls_builtin
+	     << ", \"ls_spawned_per_s\": " << ls_runs / ls_spawned
+	     << ", \"bg_jobs\": " << jobs << ", \"bg_launch_s\": " << launch << ", \"bg_reap_s\": " << reap
+	     << ", \"long_line_bytes_per_s\": " << long_runs * words.size() / long_lines
+	     << ", \"idle_wall_s\": " << idle_wall << ", \"idle_cpu_s\": " << idle_cpu << "}" << endl;
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+/**
+* Spawns per second of the legacy launch handshake (pid pipe + named semaphore + fork)
+* against ss::spawn (vfork with SIGCHLD blocked).
+* Usage: spawn_bench [iterations] [command]
+*/
+#include "spawn.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <semaphore.h>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+static double now () {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+/**
+* The launch sequence ss::ls used before the spawn engine
+*/
+static void legacy_launch (vector<string>& tokens) {
+
+	int pipefd[2];
+	if (pipe(pipefd) == -1) {
+		perror("pipe");
+		exit(EXIT_FAILURE);
+	}
+
+	pid_t p = fork();
+
+	if (p == 0) { // child
+
+		close(pipefd[0]);
+		pid_t child = getpid();
+		if (write(pipefd[1], &child, sizeof(pid_t)) == -1) {
+			perror("write");
+		}
+		close(pipefd[1]);
+
+		sem_t* consume = sem_open((string("/p") + std::to_string(child)).c_str(), O_CREAT, S_IRUSR | S_IWUSR, 0);
+		sem_wait(consume);
+		sem_close(consume);
+		sem_unlink((string("/p") + std::to_string(child)).c_str());
+
+		char** argv = new char*[tokens.size() + 1];
+		for (size_t i = 0; i < tokens.size(); ++i) {
+			argv[i] = const_cast<char*>(tokens[i].c_str());
+		}
+		argv[tokens.size()] = nullptr;
+
+		execvp(argv[0], argv);
+		exit(EXIT_FAILURE);
+	}
+
+	pid_t child;
+	close(pipefd[1]);
+	if (read(pipefd[0], &child, sizeof(pid_t)) != sizeof(pid_t)) {
+		perror("read");
+	}
+	close(pipefd[0]);
+
+	sem_t* consume = sem_open((string("/p") + std::to_string(child)).c_str(), O_CREAT, S_IRUSR | S_IWUSR, 0);
+	sem_post(consume);
+	sem_close(consume);
+
+	waitpid(child, nullptr, 0);
+
+}
+
+static void engine_launch (vector<string>& tokens) {
+
+	ss::spawn_plan plan;
+	ss::make_plan(tokens, plan);
+
+	sigset_t orig_mask;
+	ss::block_sigchld(orig_mask);
+	pid_t child = ss::spawn(plan, orig_mask);
+	ss::restore_sigmask(orig_mask);
+
+	if (child > 0) {
+		waitpid(child, nullptr, 0);
+	}
+
+}
+
+int main (int argc, char* argv[]) {
+
+	int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+	vector<string> tokens;
+	tokens.push_back(argc > 2 ? argv[2] : "true");
+
+	double start = now();
+	for (int i = 0; i < iterations; ++i) {
+		legacy_launch(tokens);
+	}
+	double legacy = iterations / (now() - start);
+
+	start = now();
+	for (int i = 0; i < iterations; ++i) {
+		engine_launch(tokens);
+	}
+	double engine = iterations / (now() - start);
+
+	cout << "{\"bench\": \"spawn\", \"command\": \"" << tokens[0] << "\", \"iterations\": " << iterations
+	     << ", \"legacy_per_sec\": " << legacy << ", \"engine_per_sec\": " << engine << "}" << endl;
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+/**
+* Stress test of the wait builtin: a script launches many short background jobs,
+* which run concurrently, and then waits for all of them with time wait.
+* Reports how long the launches and the wait took.
+* Usage: wait_bench [jobs] [shell]
+*/
+#include "reaper.h"
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using std::cout;
+using std::endl;
+using std::string;
+
+int main (int argc, char* argv[]) {
+
+	int jobs = argc > 1 ? atoi(argv[1]) : 10000;
+	string shell = argc > 2 ? argv[2] : "./main";
+	string base = "/tmp/ss_wait_bench." + std::to_string(getpid());
+	string script = base + ".ss";
+	string report = base + ".err";
+
+	std::ofstream out(script.c_str());
+	out << "retain " << jobs << "\n";
+	for (int i = 0; i < jobs; ++i) {
+		out << "bg --restart=never sleep 0.5\n";
+	}
+	out << "time wait\n";
+	out.close();
+
+	double start = ss::monotonic_now();
+
+	pid_t child = fork();
+
+	if (child == 0) {
+		if (freopen(report.c_str(), "w", stderr) == nullptr) {
+			_exit(127);
+		}
+		execl(shell.c_str(), shell.c_str(), "-e", script.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	int status = 0;
+	waitpid(child, &status, 0);
+	double total = ss::monotonic_now() - start;
+
+	// the shell reports the wait as "real <seconds>s  (builtin)  exit <status>"
+	double wait_time = -1;
+	std::ifstream err(report.c_str());
+	string word;
+	while (err >> word) {
+		if (word == "real" && err >> word) {
+			wait_time = atof(word.c_str());
+		}
+	}
+
+	unlink(script.c_str());
+	unlink(report.c_str());
+
+	cout << "{\"bench\": \"wait\", \"jobs\": " << jobs
+	     << ", \"exit\": " << (WIFEXITED(status) ? WEXITSTATUS(status) : -1)
+	     << ", \"total_s\": " << total
+	     << ", \"wait_s\": " << wait_time
+	     << ", \"launch_s\": " << total - wait_time << "}" << endl;
+
+	return 0;
+}
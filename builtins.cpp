@@ -0,0 +1,246 @@
+#include "builtins.h"
+#include "cmds.h"
+#include "parallel.h"
+#include "stats.h"
+#include "pathcache.h"
+#include "ls.h"
+#include "histlog.h"
+#include "jobtop.h"
+#include "script.h"
+#include <dlfcn.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+/**
+* Compare two names at compile time the way strcmp does
+*/
+static constexpr bool name_less (const char* a, const char* b) {
+
+	return *a != *b ? static_cast<unsigned char>(*a) < static_cast<unsigned char>(*b)
+	                : *a != '\0' && name_less(a + 1, b + 1);
+
+}
+
+/**
+* Check at compile time that a table is strictly sorted by name
+*/
+static constexpr bool sorted (const builtin* table, size_t n) {
+
+	return n < 2 || (name_less(table[0].name, table[1].name) && sorted(table + 1, n - 1));
+
+}
+
+/**
+* The core builtins. Keep them sorted by name, the build fails otherwise
+*/
+static constexpr builtin core[] = {
+	{ ":", ss::true_command, nullptr },
+	{ "[", ss::test, nullptr },
+	{ "cd", ss::cd, nullptr },
+	{ "clear", ss::clear_screen, nullptr },
+	{ "enable", ss::enable, nullptr },
+	{ "false", ss::false_command, nullptr },
+	{ "hash", ss::hash, nullptr },
+	{ "history", ss::history, nullptr },
+	{ "jobtop", ss::jobtop, nullptr },
+	{ "ls", ss::ls, nullptr },
+	{ "output", ss::output, nullptr },
+	{ "parallel", ss::parallel, nullptr },
+	{ "query", ss::query, nullptr },
+	{ "retain", ss::retain, nullptr },
+	{ "show", ss::show_pids, nullptr },
+	{ "stats", ss::stats, nullptr },
+	{ "test", ss::test, nullptr },
+	{ "true", ss::true_command, nullptr },
+	{ "wait", ss::wait_jobs, nullptr },
+};
+
+static const size_t core_size = sizeof(core) / sizeof(core[0]);
+
+static_assert(sorted(core, core_size), "core builtins must be sorted by name");
+
+/**
+* A builtin loaded from a shared library
+*/
+struct loaded_builtin {
+	builtin entry;
+	string library;
+	void* handle; // one dlopen reference per builtin, so each can be unloaded on its own
+};
+
+/**
+* Loaded builtins by name
+*/
+static std::unordered_map<string, loaded_builtin> loaded;
+
+const builtin* find_builtin (const string& name) {
+
+	const builtin* found = std::lower_bound(core, core + core_size, name.c_str(),
+		[](const builtin& entry, const char* key) { return strcmp(entry.name, key) < 0; });
+
+	if (found != core + core_size && name == found -> name) {
+		return found;
+	}
+
+	if (loaded.empty()) {
+		return nullptr;
+	}
+
+	std::unordered_map<string, loaded_builtin>::const_iterator plugin = loaded.find(name);
+
+	return plugin != loaded.cend() ? &plugin -> second.entry : nullptr;
+
+}
+
+vector<string> builtin_names () {
+
+	vector<string> names;
+
+	for (size_t i = 0; i < core_size; ++i) {
+		names.push_back(core[i].name);
+	}
+
+	for (std::unordered_map<string, loaded_builtin>::const_iterator iter = loaded.cbegin(); iter != loaded.cend(); iter++) {
+		names.push_back(iter -> first);
+	}
+
+	return names;
+
+}
+
+void call_builtin (const builtin& command, vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	if (command.plugin == nullptr) {
+		command.run(tokens, run_in_fg, redir);
+		return;
+	}
+
+	vector<char*> argv;
+	argv.reserve(tokens.size() + 1);
+
+	for (vector<string>::iterator iter = tokens.begin(); iter != tokens.end(); iter++) {
+		argv.push_back(&(*iter)[0]);
+	}
+
+	argv.push_back(nullptr);
+
+	// the plugin may write to the descriptors or through stdio, keep the order of the output
+	cout.flush();
+	cerr.flush();
+
+	last_status = command.plugin -> run(static_cast<int>(tokens.size()), argv.data());
+
+	fflush(stdout);
+	fflush(stderr);
+
+}
+
+/**
+* Load one builtin from a library
+* @return false, with a message printed, if it cannot be loaded
+*/
+static bool load_builtin (const string& library, const string& name) {
+
+	if (find_builtin(name) != nullptr) {
+		cerr << "enable: " << name << " is already a builtin\n";
+		return false;
+	}
+
+	void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+	if (handle == nullptr) {
+		cerr << "enable: " << dlerror() << endl;
+		return false;
+	}
+
+	const ss_plugin* plugin = static_cast<const ss_plugin*>(dlsym(handle, (name + "_builtin").c_str()));
+
+	if (plugin == nullptr || plugin -> abi != SS_PLUGIN_ABI || plugin -> run == nullptr) {
+		if (plugin == nullptr) {
+			cerr << "enable: " << library << " does not provide " << name << "_builtin\n";
+		} else {
+			cerr << "enable: " << name << " was built for plugin ABI " << plugin -> abi
+			     << ", the shell uses " << SS_PLUGIN_ABI << endl;
+		}
+		dlclose(handle);
+		return false;
+	}
+
+	std::unordered_map<string, loaded_builtin>::iterator slot = loaded.insert(std::make_pair(name, loaded_builtin())).first;
+	loaded_builtin& entry = slot -> second;
+	entry.library = library;
+	entry.handle = handle;
+	entry.entry.name = slot -> first.c_str(); // the name it was enabled as, whatever the plugin calls itself
+	entry.entry.run = nullptr;
+	entry.entry.plugin = plugin;
+
+	return true;
+
+}
+
+void enable (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	if (tokens.size() == 1) {
+
+		for (size_t i = 0; i < core_size; ++i) {
+			cout << "enable " << core[i].name << endl;
+		}
+
+		for (std::unordered_map<string, loaded_builtin>::const_iterator iter = loaded.cbegin(); iter != loaded.cend(); iter++) {
+			cout << "enable -f " << iter -> second.library << " " << iter -> first;
+			if (iter -> second.entry.plugin -> usage != nullptr) {
+				cout << "\t" << iter -> second.entry.plugin -> usage;
+			}
+			cout << endl;
+		}
+
+		return;
+	}
+
+	if (tokens[1] == "-f" && tokens.size() >= 4) {
+
+		for (size_t i = 3; i < tokens.size(); ++i) {
+			if (!load_builtin(tokens[2], tokens[i])) {
+				last_status = EXIT_FAILURE;
+			}
+		}
+
+		return;
+	}
+
+	if (tokens[1] == "-d" && tokens.size() >= 3) {
+
+		for (size_t i = 2; i < tokens.size(); ++i) {
+
+			std::unordered_map<string, loaded_builtin>::iterator plugin = loaded.find(tokens[i]);
+
+			if (plugin == loaded.end()) {
+				cerr << "enable: " << tokens[i] << " is not a loaded builtin\n";
+				last_status = EXIT_FAILURE;
+				continue;
+			}
+
+			dlclose(plugin -> second.handle);
+			loaded.erase(plugin);
+		}
+
+		return;
+	}
+
+	cerr << "Wrong arguments! \n";
+	cerr << "Correct form: enable [-f <library> <name>... | -d <name>...]\n";
+	last_status = EXIT_FAILURE;
+
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef _BUILTINS_H_
+#define _BUILTINS_H_
+
+#include <string>
+#include <vector>
+
+#include "ss_plugin.h"
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Define the function pointer type for the functions supporting builtin commands
+*/
+typedef void (*func_ptr) (vector<string>&, bool, bool);
+
+/**
+* A command run inside the shell: one of the core builtins, or one loaded from a plugin
+*/
+struct builtin {
+	const char* name;
+	func_ptr run;             // core builtins
+	const ss_plugin* plugin;  // loaded builtins
+};
+
+/**
+* Find a builtin by name. The core builtins live in a table sorted at compile time
+* and are found by binary search; loaded builtins are looked up in a hash table
+* @param name The command name
+* @return The builtin, or nullptr if the command is not one
+*/
+const builtin* find_builtin (const string& name);
+
+/**
+* @return The names of the core and loaded builtins
+*/
+vector<string> builtin_names ();
+
+/**
+* Run a builtin
+* @param command The builtin, as returned by find_builtin
+* @param tokens A list of the command name and its arguments, without redirections
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output is redirected or not
+*/
+void call_builtin (const builtin& command, vector<string>& tokens, bool run_in_fg, bool redir);
+
+/**
+* Command that manages loadable builtins:
+* enable lists every builtin, enable -f <library> <name>... loads builtins from a shared library
+* and enable -d <name>... unloads them again
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void enable (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
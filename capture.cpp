@@ -0,0 +1,213 @@
+#include "capture.h"
+#include "cmds.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+/**
+* Rings whose pipes are still open, by read end. Holding a reference keeps a ring alive
+* until end of file even if its job has already left ps
+*/
+static std::unordered_map<int, std::shared_ptr<output_ring> > draining;
+
+/**
+* Reads served per wakeup, so that one chatty job cannot starve the others or the prompt
+*/
+static const int reads_per_wakeup = 16;
+
+/**
+* Append what was just read to the spill log, rotating it when it is full
+*/
+static void spill (output_ring& ring, const char* data, size_t length) {
+
+	if (ring.spill_fd == -1) {
+		return;
+	}
+
+	if (ring.spilled + length > ring.data.size() * spill_rotate_rings) {
+		close(ring.spill_fd);
+		rename(ring.spill_path.c_str(), (ring.spill_path + ".1").c_str());
+		ring.spill_fd = open(ring.spill_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+		ring.spilled = 0;
+		if (ring.spill_fd == -1) {
+			return;
+		}
+	}
+
+	if (write(ring.spill_fd, data, length) > 0) {
+		ring.spilled += length;
+	}
+
+}
+
+/**
+* Read a job's pipe straight into its ring, wrapping around the end
+*/
+static void drain (int fd) {
+
+	std::unordered_map<int, std::shared_ptr<output_ring> >::iterator entry = draining.find(fd);
+
+	if (entry == draining.end()) {
+		return;
+	}
+
+	output_ring& ring = *entry -> second;
+	size_t size = ring.data.size();
+
+	for (int i = 0; i < reads_per_wakeup; ++i) {
+
+		size_t head = ring.total % size;
+		struct iovec parts[2] = { { &ring.data[head], size - head }, { &ring.data[0], head } };
+		ssize_t n = readv(fd, parts, head == 0 ? 1 : 2);
+
+		if (n > 0) {
+			size_t first = std::min(size_t(n), size - head);
+			spill(ring, &ring.data[head], first);
+			spill(ring, &ring.data[0], n - first);
+			ring.total += n;
+			continue;
+		}
+
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (n == 0 || errno != EAGAIN) { // every writer is gone
+			unwatch_fd(fd);
+			close(fd);
+			ring.fd = -1;
+			if (ring.spill_fd != -1) {
+				close(ring.spill_fd);
+				ring.spill_fd = -1;
+			}
+			draining.erase(entry);
+		}
+
+		return;
+	}
+
+}
+
+int open_capture (size_t size, const string& spill_path, std::shared_ptr<output_ring>& ring) {
+
+	int pipefd[2];
+
+	if (pipe2(pipefd, O_CLOEXEC) == -1) {
+		perror("Error creating the capture pipe");
+		return -1;
+	}
+
+	ring = std::make_shared<output_ring>();
+	ring -> data.resize(size);
+	ring -> total = 0;
+	ring -> fd = pipefd[0];
+	ring -> spill_path = spill_path;
+	ring -> spill_fd = -1;
+	ring -> spilled = 0;
+
+	if (!spill_path.empty()) {
+		ring -> spill_fd = open(spill_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+		if (ring -> spill_fd == -1) {
+			perror(spill_path.c_str()); // the ring still works
+		}
+	}
+
+	fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+
+	if (!watch_fd(pipefd[0], drain)) {
+		perror("Error watching the capture pipe");
+		close(pipefd[0]);
+		close(pipefd[1]);
+		if (ring -> spill_fd != -1) {
+			close(ring -> spill_fd);
+		}
+		ring.reset();
+		return -1;
+	}
+
+	draining[pipefd[0]] = ring;
+	return pipefd[1];
+
+}
+
+void close_captures () {
+
+	for (std::unordered_map<int, std::shared_ptr<output_ring> >::iterator iter = draining.begin(); iter != draining.end(); iter++) {
+		unwatch_fd(iter -> first);
+		close(iter -> first);
+		iter -> second -> fd = -1;
+		if (iter -> second -> spill_fd != -1) {
+			close(iter -> second -> spill_fd);
+			iter -> second -> spill_fd = -1;
+		}
+	}
+
+	draining.clear();
+
+}
+
+unsigned long long write_capture (std::ostream& out, const output_ring& ring) {
+
+	size_t size = ring.data.size();
+
+	if (ring.total <= size) {
+		out.write(ring.data.data(), ring.total);
+		return 0;
+	}
+
+	size_t head = ring.total % size; // the oldest byte
+	out.write(ring.data.data() + head, size - head);
+	out.write(ring.data.data(), head);
+	return ring.total - size;
+
+}
+
+void output (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	char* end = nullptr;
+	long target = tokens.size() == 2 ? strtol(tokens[1].c_str(), &end, 10) : 0;
+
+	if (tokens.size() != 2 || end == tokens[1].c_str() || *end != '\0' || target <= 0) {
+		cerr << "Correct form: output <pid>\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
+
+	const process* entry = ps.find(target);
+
+	if (entry == nullptr || !entry -> output) {
+		cerr << "Simple Shell has no captured output for pid " << target << ". Run jobs with bg --capture.\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
+
+	std::shared_ptr<output_ring> ring = entry -> output; // the entry may be trimmed by the dispatch
+	reaper_dispatch(); // take in whatever the job wrote since the last wakeup
+
+	unsigned long long dropped = write_capture(cout, *ring);
+	cout.flush();
+
+	if (dropped > 0) {
+		cerr << "[" << dropped << " earlier bytes dropped";
+		if (!ring -> spill_path.empty()) {
+			cerr << ", see " << ring -> spill_path;
+		}
+		cerr << "]\n";
+	}
+
+}
+
+}
@@ -0,0 +1,80 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <sys/types.h>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* The captured stdout and stderr of a job: the last bytes it wrote, kept in a fixed-size ring,
+* and optionally every byte appended to a spill log that rotates once it grows past a limit.
+* The read end of the job's pipe is drained by reaper_dispatch, so the job never blocks on a full pipe
+* and the shell's memory stays bounded however much it writes
+*/
+struct output_ring {
+	vector<char> data;       // the ring
+	unsigned long long total; // bytes received; the ring holds the last min(total, data.size())
+	int fd;                  // read end of the job's pipe, -1 once it hit end of file
+	int spill_fd;            // spill log, or -1
+	string spill_path;
+	size_t spilled;          // bytes in the current spill log
+};
+
+/**
+* Default ring size of --capture
+*/
+const size_t default_capture_size = 64 * 1024;
+
+/**
+* Largest ring allowed
+*/
+const size_t max_capture_size = 64 * 1024 * 1024;
+
+/**
+* A spill log is rotated to <path>.1 once it holds this many ring sizes
+*/
+const size_t spill_rotate_rings = 16;
+
+/**
+* Create the pipe a job writes its output to, drained into a new ring
+* @param size Size of the ring
+* @param spill Path of the spill log, empty for none
+* @param ring Receives the ring, to be stored with the job
+* @return The write end, close-on-exec, for the job's stdout and stderr; the caller closes it
+* once the job is spawned. -1 if the pipe could not be set up
+*/
+int open_capture (size_t size, const string& spill, std::shared_ptr<output_ring>& ring);
+
+/**
+* Close the read ends and spill logs of every ring still draining, in a forked subshell:
+* the rings belong to the parent shell, which keeps draining them
+*/
+void close_captures ();
+
+/**
+* Write what a ring holds, oldest byte first
+* @param out Where to write it
+* @param ring The ring
+* @return The number of bytes that were dropped from the ring because it overflowed
+*/
+unsigned long long write_capture (std::ostream& out, const output_ring& ring);
+
+/**
+* Command that prints the captured output of a job run with --capture:
+* output <pid> prints what its ring holds, and reports on stderr how many older bytes were dropped
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void output (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
@@ -1,15 +1,27 @@
 #include "cmds.h"
+#include "spawn.h"
+#include "redirect.h"
+#include "builtins.h"
+#include "reaper.h"
+#include "pipeline.h"
+#include "parallel.h"
+#include "procstat.h"
+#include "stats.h"
+#include "pathcache.h"
+#include "affinity.h"
 #include <unistd.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <csignal>
 #include <sys/stat.h>
-#include <semaphore.h>
 #include <fcntl.h>
-#include <fstream>
 #include <iostream>
 #include <cerrno>
 #include <algorithm>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
 
 using std::cout;
 using std::cerr;
@@ -17,262 +29,223 @@ using std::endl;
 
 namespace ss {
 
-map<string, func_ptr> commands;
+job_table ps;
 
-map<string, func_ptr1> commands_wo_args;
+job_options options;
 
-vector<process> ps;
+int last_status = EXIT_SUCCESS;
 
-void cmd_initialize () {
+void reset_options () {
 
-	// commands with arguments
-	commands.insert(pair<string, func_ptr>("ls", ss::ls));
-	commands.insert(pair<string, func_ptr>("cd", ss::cd));
-	commands.insert(pair<string, func_ptr>("query", ss::query));
-
-	//commands without arguments
-	commands_wo_args.insert(pair<string, func_ptr1>("show", ss::show_pids));
-	commands_wo_args.insert(pair<string, func_ptr1>("clear", ss::clear_screen));
+	options.restart = restart_on_signal;
+	options.history.restarts = 0;
+	options.history.window_start = 0;
+	options.history.backoff_ms = 0;
+	options.timed = false;
+	clear_limits(options.limits);
+	options.pinned = false;
+	options.capture = 0;
+	options.spill.clear();
 
 }
 
-void ch_handler (int signum) { // reap child process when SIGCHLD arrives
-
-	pid_t child;
-	int status;
-
-	while ((child = waitpid(-1, &status, WNOHANG)) > 0) { // reap terminated child's status
-		
-		if(WIFEXITED(status)) { // child terminated normally
-			
-			for(vector<process>::iterator iter = ps.begin(); iter != ps.end(); iter++) {
-
-				if (iter -> pid == child) {
-					iter -> reaped = true;
-					iter -> state = 0;
-					break;			
-				}
-			}
-			
-			continue;
-		}
-
-		if(WIFSIGNALED(status)) { // child terminated by signal
-			
-			for(vector<process>::iterator iter = ps.begin(); iter != ps.end(); iter++) {
-			
-				if (iter -> pid == child) {
-					iter -> reaped = true;
-					iter -> state = WTERMSIG(status);
-					break;			
-				}
-			}
+void wait_fg (pid_t child) {
 
-			if(WTERMSIG(status) == SIGSEGV || WTERMSIG(status) == SIGKILL) {
-				// do nothing
-			} else { // restart child process
+	const process* entry;
 
-				vector<string> m_tokens;
-				bool redir = false;
-				bool was_run_in_fg = true;
+	while ((entry = ps.find(child)) != nullptr && !entry -> reaped) { // sleep until the child terminates
+		reaper_wait();
+	}
 
-				for(vector<process>::iterator iter = ps.begin(); iter != ps.end(); iter++) {
-					
-					if (iter -> pid == child) {
-						if (!iter -> run_in_fg) {
-							was_run_in_fg = false;
-							cout << "About to restart child " << child << endl;
-							m_tokens = iter -> tokens;
-						}
-					}
+	if (entry != nullptr) {
+		last_status = entry -> state > 0 ? 128 + entry -> state : entry -> exit_code;
+	}
 
-				}
+}
 
-				if (!was_run_in_fg) { // only restart when the process was launched in the background
-					
-					vector<string>::iterator redir_opt;
+void run_command (vector<string>& tokens, bool run_in_fg, bool redir) {
 
-					redir_opt = std::find(m_tokens.begin(), m_tokens.end(), ">");
+	const builtin* command = find_builtin(tokens[0]);
 
-					if (redir_opt != m_tokens.end()) {
-						redir = true;
-					}
+	if (command == nullptr) { // not a builtin
+		run_external(tokens, run_in_fg, redir);
+		return;
+	}
 
-					recover(m_tokens, true, redir);
-				}
+	if (!redir) { // the common case needs no copy of the tokens
+		call_builtin(*command, tokens, run_in_fg, redir);
+		return;
+	}
 
-			}
-		}
+	vector<string> args;
+	vector<redirection> redirs;
+	vector<int> saved;
 
-		
+	if (!parse_redirections(tokens, args, redirs) || !redirect_shell(redirs, saved)) {
+		last_status = EXIT_FAILURE;
+		return;
 	}
 
-	// all children are reaped
-	return;	
+	call_builtin(*command, args, run_in_fg, redir);
+
+	restore_shell(saved);
 
 }
 
 void recover (vector<string>& tokens, bool run_in_fg, bool redir) {
 
-	if(commands.find(tokens[0]) != commands.end()) {
-		commands[tokens[0]](tokens, run_in_fg, redir);
+	vector<size_t> pipes = find_pipes(tokens);
+
+	if (!pipes.empty()) {
+		run_pipeline(tokens, pipes, run_in_fg);
 	} else {
-		commands_wo_args[tokens[0]](run_in_fg, redir);
+		run_command(tokens, run_in_fg, redir);
 	}
 
 }
 
-void ls (vector<string>& tokens, bool run_in_fg, bool redir) {
-	
-	// set up the pipe to send child pid to parent, in order for
-	// the parent to push the process structure reprensenting the child
-	// onto the vector
+process& add_process (pid_t child, vector<string>& tokens, bool run_in_fg, const vector<pid_t>& stages) {
+
+	process child_process;
+	child_process.pid = child;
+	child_process.reaped = false;
+	child_process.tokens = tokens;
+	child_process.state = -1;
+	child_process.run_in_fg = run_in_fg;
+	child_process.exit_code = -1;
+	child_process.restart = options.restart;
+	child_process.history = options.history;
+	child_process.stages = stages;
+	child_process.last_failed = false;
+	child_process.running = stages.empty() ? 1 : stages.size();
+	memset(&child_process.usage, 0, sizeof(child_process.usage));
+	child_process.launched = monotonic_now();
+	child_process.exec_latency = -1;
+	child_process.finished = 0;
+	child_process.timed = options.timed;
+	child_process.limits = options.limits;
+	child_process.pinned = options.pinned;
+	child_process.cpus = options.cpus;
+	return ps.add(child_process);
 
-	// child cannot push itself onto the vector as it's in 
-	// different address space than its parent
+}
 
-	int pipefd[2];
-	if (pipe(pipefd) == -1) {
-		perror("Error creating pipe in ls.");
-	}
+void record_launch (process& entry, const spawn_plan& plan) {
 
-	pid_t p;
-	p = fork();
+	entry.launched = plan.fork_time;
+	entry.exec_latency = plan.exec_time - plan.fork_time;
 
-	if (p == 0) { // child
-		
-		close(pipefd[0]); // close read end
-	
-		pid_t child = getpid();
-
-		if (write(pipefd[1], &child, sizeof(pid_t)) == -1) {
-			perror("Error in writing to pipe in ls.");
-		}
+}
 
-		close(pipefd[1]); // close pipe
+int open_limits () {
 
-		if (redir) {
+	return has_limits(options.limits) ? open_job_cgroup(options.limits) : -1;
 
-			vector<string>::iterator redir_opt;
-			redir_opt = std::find(tokens.begin(), tokens.end(), ">");			
+}
 
-			if (redir_opt + 1 != tokens.end()) { // ensure that a pathname follows the redirection operator
+int open_output (std::shared_ptr<output_ring>& ring) {
 
-				int fildes = open(tokens.back().c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRWXU); // write output to file
+	return options.capture > 0 ? open_capture(options.capture, options.spill, ring) : -1;
 
-				if (fildes != -1) {
-					dup2(fildes, STDOUT_FILENO);
-					dup2(fildes, STDERR_FILENO);
-					close(fildes);
-				} else {
-					perror("Error opening redirection file in ls");
-				}
+}
 
-			} else {
-				cerr << "Cannot redirect output. No destination specified.\n";
-			}
+void plan_options (spawn_plan& plan, int cgroup, int output) {
 
-			tokens.erase(redir_opt, tokens.end()); // get rid of the redirection suffix		
+	if (output != -1) { // the command's own redirections are applied after these, and win
+		vector<fd_action> capture;
+		if (plan.out_fd == -1) {
+			fd_action out = { STDOUT_FILENO, output };
+			capture.push_back(out);
 		}
+		fd_action err = { STDERR_FILENO, output };
+		capture.push_back(err);
+		plan.actions.insert(plan.actions.begin(), capture.begin(), capture.end());
+	}
 
-		// synchronize access to the global vector
-		// want the signal handler to be invoked
-		// after the parent has pushed the child struct onto the vector
-		sem_t* consume(0); 
-		consume = sem_open((string("/p") + std::to_string(child)).c_str(), 
-							O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, 0);
+	if (has_limits(options.limits)) {
+		plan.limits = &options.limits;
+		plan.cgroup_fd = cgroup;
+	}
 
-		if (consume == nullptr) {
-			perror("Error opening semaphore in ls child");
-			exit(EXIT_FAILURE);
-		}
+	if (options.pinned) {
+		plan.cpus = &options.cpus;
+	}
+
+}
 
-		sem_wait(consume);
-		sem_close(consume);
-		sem_unlink((string("/p") + std::to_string(child)).c_str());
+void run_external (vector<string>& tokens, bool run_in_fg, bool redir) {
 
-		char** argv = new char*[tokens.size() + 1]; // no freeing, but exec is going to replace the child's image
+	vector<string> args;
+	vector<redirection> redirs;
 
-		for(vector<string>::const_iterator iter = tokens.cbegin(); iter != tokens.cend(); iter++) { 
-			argv[iter - tokens.cbegin()] = const_cast<char*>((*iter).c_str()); // prepare argument array
+	if (redir) {
+		if (!parse_redirections(tokens, args, redirs)) {
+			last_status = EXIT_FAILURE;
+			return;
 		}
+	} else {
+		args = tokens;
+	}
 
-		argv[tokens.size()] = nullptr;
+	if (args.empty()) {
+		cerr << "Missing command before redirection.\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
 
-		//sleep(10); // used for testing and demo
-		execvp(argv[0], argv);
+	spawn_plan plan;
+	make_plan(args, plan);
 
-		perror("Exec in ls failed"); // successful exec should not return
-		delete[] argv;
-		exit(EXIT_FAILURE);
+	// a file that cannot be opened fails here, before anything is forked
+	vector<int> opened;
 
-	} else if (p > 0) { // parent
-		
-		pid_t waitchild; // used for waitpid only
-		pid_t child;
-		int status;
+	if (!open_redirections(redirs, plan.actions, opened)) {
+		last_status = EXIT_FAILURE;
+		return;
+	}
 
-		close(pipefd[1]); // close the write end
-		
-		read(pipefd[0], &child, sizeof(pid_t));
+	// the child cannot be reaped before its structure is pushed onto the vector
+	sigset_t orig_mask;
+	block_sigchld(orig_mask);
 
-		close(pipefd[0]); // close pipe
+	std::shared_ptr<output_ring> captured;
+	int output = open_output(captured);
+	int cgroup = open_limits();
+	plan_options(plan, cgroup, output);
+	pid_t child = spawn(plan, orig_mask);
 
-		cout << "ls parent reads child pid = " << child << endl; // used for testing and demo
-		
-		// semaphore to synchronize access to the vector storing process info
-		
-		sem_t* consume(0);
-		consume = sem_open((string("/p") + std::to_string(child)).c_str(), 
-							O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, 0);
+	if (child > 0) {
+		process& entry = add_process(child, tokens, run_in_fg);
+		record_launch(entry, plan);
+		entry.output = captured;
+	}
 
-		if (consume == nullptr) {
-			perror("Error opening semaphore in ls parent");
-			exit(EXIT_FAILURE);
-		}
-		
-		// create the structure
-		process child_process;
-		child_process.pid = child;
-		child_process.reaped = false;
-		child_process.tokens = tokens;
-		child_process.state = -1;
-		child_process.run_in_fg = run_in_fg;
-		ps.push_back(child_process);
-
-		
-		sem_post(consume);
-		sem_close(consume);
-
-		if(run_in_fg) { // fg: wait immediately
-
-			while((waitchild = waitpid(child, &status, WNOHANG)) >= 0) {
-				
-				if(waitchild > 0) {
-
-					for(vector<process>::iterator iter = ps.begin(); iter != ps.end(); iter++) {
-
-						if (iter -> pid == child) {
-							iter -> reaped = true;
-							if(WIFEXITED(status)) {
-								iter -> state = 0;
-							}
-							if(WIFSIGNALED(status)) {
-								iter -> state = WTERMSIG(status);					
-							}
-							break;	
-						}
-
-					}
-				}
-			
-			}
+	restore_sigmask(orig_mask);
+	close_redirections(opened); // the child has its own copies
+
+	if (cgroup != -1) {
+		close(cgroup);
+	}
+
+	if (output != -1) {
+		close(output);
+	}
 
+	if (child == -1) {
+		remove_job_cgroup(options.limits);
+		if (plan.exec_errno != 0) {
+			errno = plan.exec_errno;
+			perror(("Exec of " + args[0] + " failed").c_str());
+			last_status = 127;
+		} else {
+			perror("Fork failed");
+			last_status = EXIT_FAILURE;
 		}
-		
-	} else { // fork error
-		perror("Fork in ls failed");
-		exit(EXIT_FAILURE);
+		return;
+	}
+
+	if(run_in_fg) { // fg: wait immediately
+		wait_fg(child);
 	}
 
 }
@@ -283,12 +256,15 @@ void cd (vector<string>& tokens, bool run_in_fg, bool redir) {
 	if (tokens.size() != 2) {
 		cerr << "Passed in a wrong number of arguments.\n";
 		cerr << "Correct form: cd <pathname>\n";
+		last_status = EXIT_FAILURE;
 		return;
 	}
 
 	int ret = chdir(tokens[1].c_str());
 	
 	if (ret != 0) {
+		last_status = EXIT_FAILURE;
+
 		switch (errno) {
 			case ENOENT:
 				cerr << "No such file or directory.\n";
@@ -306,197 +282,308 @@ void cd (vector<string>& tokens, bool run_in_fg, bool redir) {
 	
 }
 
-void query (vector<string>& tokens, bool run_in_fg, bool redir) {
+/**
+* Print what /proc knows about a live process
+*/
+static void print_live (std::ostream& out, pid_t pid) {
+
+	proc_stat st;
 
-	// set up the pipe to send child pid to parent, in order for
-	// the parent to push the process structure reprensenting the child
-	// onto the vector
+	if (!read_proc_stat(pid, st)) {
+		out << "State: Unable to read /proc/" << pid << "/stat, the process may just have terminated.\n";
+		return;
+	}
+
+	long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+
+	out << "Name: " << st.comm << endl;
+	out << "State: " << st.state << endl;
+	out << "CPU time: " << st.utime * seconds_per_tick() << " s user, "
+	    << st.stime * seconds_per_tick() << " s system" << endl;
+	out << "RSS: " << st.rss * page_kb << " kB" << endl;
+	out << "Threads: " << st.num_threads << endl;
+
+}
+
+/**
+* Print the resources used by a reaped job
+*/
+static void print_usage (std::ostream& out, const struct rusage& usage) {
+
+	out << "CPU time: " << usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 << " s user, "
+	    << usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6 << " s system" << endl;
+	out << "Max RSS: " << usage.ru_maxrss << " kB" << endl;
+	out << "Context switches: " << usage.ru_nvcsw << " voluntary, " << usage.ru_nivcsw << " involuntary" << endl;
+
+}
+
+void query (vector<string>& tokens, bool run_in_fg, bool redir) {
 
-	// child cannot push itself onto the vector as it's in 
-	// different address space than its parent
+	// runs in the shell itself, so the answer reflects ps as it is now
+	char* end = nullptr;
+	long target = tokens.size() == 2 ? strtol(tokens[1].c_str(), &end, 10) : 0;
 
-	int pipefd[2];
-	if (pipe(pipefd) == -1) {
-		perror("Error creating pipe in query");
+	if (tokens.size() != 2 || end == tokens[1].c_str() || *end != '\0' || target <= 0) {
+		cerr << "Wrong number of arguments! \n";
+		cerr << "Correct form: query <pid>\n";
+		last_status = EXIT_FAILURE;
+		return;
 	}
 
-	pid_t p;
-	p = fork();
+	const process* entry = ps.find(target);
 
-	if (p == 0) { // child
+	if (entry == nullptr) {
+		cerr << "Simple Shell has not run a process of the specified pid\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
 
-		close(pipefd[0]); // close read end
-	
-		pid_t child = getpid();
+	cout << "Pid: " << target << endl;
+	cout << "Reaped: " << entry -> reaped << endl;
 
-		if (write(pipefd[1], &child, sizeof(pid_t)) == -1) {
-			perror("Error in query writing to pipe");
+	if (!entry -> stages.empty()) {
+		cout << "Pipeline stages:";
+		for (vector<pid_t>::const_iterator stage = entry -> stages.cbegin(); stage != entry -> stages.cend(); stage++) {
+			cout << " " << *stage;
 		}
+		cout << endl;
+	}
+
+	if (has_limits(entry -> limits)) {
+		print_limits(cout, entry -> limits);
+	}
 
-		close(pipefd[1]); // close pipe
-		
-		if (redir) {
+	if (entry -> pinned) {
+		cout << "CPUs: " << format_cpu_list(entry -> cpus) << endl;
+	}
 
-			vector<string>::iterator redir_opt;
-			redir_opt = std::find(tokens.begin(), tokens.end(), ">");			
+	if (entry -> output) {
+		cout << "Output: " << entry -> output -> total << " bytes captured, the last " << entry -> output -> data.size()
+		     << " kept" << (entry -> output -> fd == -1 ? ", closed" : "") << endl;
+	}
 
-			if (redir_opt + 1 != tokens.end()) {
+	if (!entry -> reaped) { // process still active, read from /proc
+		print_live(cout, target);
+		return;
+	}
 
-				int fildes = open(tokens.back().c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRWXU); // write output to file
+	if (entry -> state == 0) {
+		cout << "State: " << "Terminated normally by calling exit.\n";
+		cout << "Exit code: " << entry -> exit_code << endl;
+	} else {
+		cout << "State: " << "Terminated by signal " << entry -> state << endl;
+	}
 
-				if (fildes != -1) {
-					dup2(fildes, STDOUT_FILENO);
-					dup2(fildes, STDERR_FILENO);
-					if (close(fildes) == -1) {
-						perror(nullptr);
-					}
-				} else {
-					perror("Cannot redirect output. Error opening the destination file.");
-				}
+	print_usage(cout, entry -> usage);
 
-			} else {
-				cerr << "Cannot redirect output. No destination specified.\n";
-			}
+}
 
-			tokens.erase(redir_opt, tokens.end()); // get rid of the redirection suffix, if any		
-		}
+void retain (vector<string>& tokens, bool run_in_fg, bool redir) {
 
-		// synchronize access to the global vector
-		// want the signal handler to be invoked
-		// after the parent has pushed the child struct onto the vector
-		sem_t* consume(0); 
-		consume = sem_open((string("/p") + std::to_string(child)).c_str(), 
-							O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, 0);
+	if (tokens.size() == 1) {
+		cout << "Retaining up to " << ps.retention() << " reaped processes.\n";
+		return;
+	}
 
-		if (consume == nullptr) {
-			perror("Error opening semaphore in ls child");
-			exit(EXIT_FAILURE);
-		}
+	char* end = nullptr;
+	unsigned long max_reaped = tokens.size() == 2 ? strtoul(tokens[1].c_str(), &end, 10) : 0;
+
+	if (tokens.size() != 2 || end == tokens[1].c_str() || *end != '\0' || tokens[1][0] == '-') {
+		cerr << "Wrong number of arguments! \n";
+		cerr << "Correct form: retain [<number of reaped processes>]\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
+
+	ps.set_retention(max_reaped);
+
+}
+
+/**
+* Jobs the wait builtin is waiting for, by id, with the index of the pid that named them
+*/
+static std::unordered_map<unsigned long, size_t> awaited;
+
+/**
+* Exit statuses of the pids given to wait, filled in as their jobs are reaped
+*/
+static vector<int> awaited_status;
+
+/**
+* Background jobs that finished but were not waited for yet, oldest first, as (id, exit status).
+* wait -n returns the oldest; bounded by the retention of ps
+*/
+static std::deque<std::pair<unsigned long, int> > unwaited;
+
+/**
+* The listener that was installed before wait installed its own
+*/
+static reap_listener chained = nullptr;
+
+static int job_status (const process& entry) {
+
+	return entry.state > 0 ? 128 + entry.state : entry.exit_code;
+
+}
+
+void job_finished (const process& entry) {
+
+	if (entry.run_in_fg) {
+		return;
+	}
+
+	unwaited.push_back(std::make_pair(entry.id, job_status(entry)));
+
+	if (unwaited.size() > ps.retention()) {
+		unwaited.pop_front();
+	}
+
+}
+
+void forget_jobs () {
 
-		sem_wait(consume);
-		sem_close(consume);
-		sem_unlink((string("/p") + std::to_string(child)).c_str());
+	close_captures();
+	ps.clear();
+	unwaited.clear();
 
-		// query processes run in simple shell
-		if (tokens.size() != 2) {
-			cerr << "Wrong number of arguments! \n";
-			cerr << "Correct form: query <pid>\n";
-			exit(EXIT_FAILURE);
+}
+
+/**
+* Drop a job from the finished jobs wait -n would return, once it was waited for by pid
+*/
+static void forget_unwaited (unsigned long id) {
+
+	for (std::deque<std::pair<unsigned long, int> >::iterator iter = unwaited.begin(); iter != unwaited.end(); iter++) {
+		if (iter -> first == id) {
+			unwaited.erase(iter);
+			return;
 		}
+	}
 
-		string t_pid = tokens[1];
-		pid_t target = std::stoi(t_pid, nullptr);
+}
 
-		bool found = false;		
-		
-		for (vector<process>::const_iterator iter = ps.cbegin(); iter != ps.cend(); iter++) {
-			if (iter -> pid == target) {
+/**
+* Reap listener checking off the jobs wait is waiting for
+*/
+static void job_waited (const process& entry) {
 
-				found = true;
-				cout << "Pid: " << target << endl;
-				cout << "Reaped: " << iter -> reaped << endl;
+	if (chained != nullptr) {
+		chained(entry);
+	}
 
-				if (iter -> state == 0) {
-					cout << "State: " << "Terminated normally by calling exit.\n";
-				} else {
+	std::unordered_map<unsigned long, size_t>::iterator slot = awaited.find(entry.id);
 
-					if (iter -> state == -1) { // process still active, read from /proc
-						string line;
-						std::fstream fs;
-						fs.open(("/proc/" + tokens[1] + "/status").c_str(), std::fstream::in);
+	if (slot != awaited.end()) {
+		awaited_status[slot -> second] = job_status(entry);
+		awaited.erase(slot);
+		forget_unwaited(entry.id);
+	}
 
-						if (fs.is_open()) { ;
+}
 
-							for(int i = 0; i < 2; ++i) { // just want the name and the state of the process
-								getline(fs, line);
-								cout << line << endl;
-							}
+void wait_jobs (vector<string>& tokens, bool run_in_fg, bool redir) {
 
-							fs.close();
+	bool any = tokens.size() > 1 && tokens[1] == "-n";
+	size_t first = any ? 2 : 1; // the first pid
 
-						} else {
-							perror("Unable to read process status. Check if pid is correct.");
-						}
+	if (any && tokens.size() == first) {
 
-					} else {
-						cout << "State: " << "Terminated by signal " << iter -> state << endl;
-					}
-				}
-			}
+		// a job that finished earlier is returned first; a crashed job waiting out its backoff comes back
+		while (unwaited.empty() && (ps.live() > 0 || restarts_pending())) {
+			reaper_wait();
 		}
 
-		if (!found) {
-			cerr << "Simple Shell has not run a process of the specified pid\n";
+		if (unwaited.empty()) {
+			last_status = 127;
+		} else {
+			last_status = unwaited.front().second;
+			unwaited.pop_front();
 		}
-		
-		exit(EXIT_SUCCESS);
+		return;
+	}
+
+	if (tokens.size() == first) {
+
+		while (ps.live() > 0 || restarts_pending()) { // restarted jobs are waited for too
+			reaper_wait();
+		}
+
+		unwaited.clear();
+		last_status = EXIT_SUCCESS;
+		return;
+	}
+
+	awaited.clear();
+	awaited_status.assign(tokens.size() - first, 127);
 
-	} else if (p > 0) { // parent
+	const process* done = nullptr; // for wait -n, the listed job that finished first
 
-		pid_t waitchild; // used for waitpid only
-		pid_t child;
-		int status;
+	for (size_t i = first; i < tokens.size(); ++i) {
 
-		close(pipefd[1]); // close the write end
-		
-		read(pipefd[0], &child, sizeof(pid_t));
+		char* end = nullptr;
+		long pid = strtol(tokens[i].c_str(), &end, 10);
+		const process* entry = end != tokens[i].c_str() && *end == '\0' && pid > 0 ? ps.find(pid) : nullptr;
 
-		close(pipefd[0]); // close pipe
+		if (entry == nullptr) {
+			cerr << "wait: pid " << tokens[i] << " is not a child of this shell\n";
+		} else if (entry -> reaped) {
+			awaited_status[i - first] = job_status(*entry);
+			if (!any) {
+				forget_unwaited(entry -> id);
+			} else if (done == nullptr || entry -> finished < done -> finished) {
+				done = entry;
+			}
+		} else {
+			awaited[entry -> id] = i - first;
+		}
+	}
 
-		cout << "query parent reads child pid = " << child << endl; // used for testing and demo
-		
-		// semaphore to synchronize the access to the vector storing process info
-		
-		sem_t* consume(0);
-		consume = sem_open((string("/p") + std::to_string(child)).c_str(), 
-							O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, 0);
+	if (any) {
+
+		if (done != nullptr) {
+			forget_unwaited(done -> id);
+			last_status = job_status(*done);
+			return;
+		}
 
-		if (consume == nullptr) {
-			perror("Error opening semaphore in query parent process.");
-			exit(EXIT_FAILURE);
+		if (awaited.empty()) {
+			last_status = 127;
+			return;
 		}
-		
-		process child_process;
-		child_process.pid = child;
-		child_process.reaped = false;
-		child_process.tokens = tokens;
-		child_process.state = -1;
-		child_process.run_in_fg = run_in_fg;
-		ps.push_back(child_process);
-
-		sem_post(consume);
-		sem_close(consume);
-
-		if(run_in_fg) { // fg: wait immediately
-			
-			while((waitchild = waitpid(child, &status, WNOHANG)) >= 0) {
-				
-				if(waitchild > 0) {
-
-					for(vector<process>::iterator iter = ps.begin(); iter != ps.end(); iter++) {
-						if (iter -> pid == child) {
-							iter -> reaped = true;
-							if(WIFEXITED(status)) {
-								iter -> state = 0;
-							}
-							if(WIFSIGNALED(status)) {
-								iter -> state = WTERMSIG(status);					
-							}	
-						}
-					}
-				}
-			
+
+		// the status of whichever listed job is checked off first
+		std::unordered_map<unsigned long, size_t> listed = awaited;
+		chained = set_reap_listener(job_waited);
+
+		while (awaited.size() == listed.size()) {
+			reaper_wait();
+		}
+
+		set_reap_listener(chained);
+
+		for (std::unordered_map<unsigned long, size_t>::const_iterator iter = listed.cbegin(); iter != listed.cend(); iter++) {
+			if (awaited.count(iter -> first) == 0) {
+				last_status = awaited_status[iter -> second];
+				break;
 			}
+		}
 
-		} 
-		
-	} else { // fork error
-		perror(nullptr);
-		exit(EXIT_FAILURE);
+		awaited.clear();
+		return;
 	}
+
+	chained = set_reap_listener(job_waited);
+
+	while (!awaited.empty()) {
+		reaper_wait();
+	}
+
+	set_reap_listener(chained);
+	last_status = awaited_status.back();
+
 }
 
-void show_pids (bool run_in_fg, bool redir) {
+void show_pids (vector<string>& tokens, bool run_in_fg, bool redir) {
 
 	if(!ps.empty()) {
 		cout << "Pids of processes that simple shell has run in this session: \n\n";
@@ -504,14 +591,14 @@ void show_pids (bool run_in_fg, bool redir) {
 		cout << "Simple shell has not run any processes yet. \n";
 	}
 
-	for(vector<process>::const_iterator iter = ps.cbegin(); iter != ps.cend(); iter++) {
+	for(job_table::const_iterator iter = ps.cbegin(); iter != ps.cend(); iter++) {
 		cout << "Pid: " << iter -> pid << "\nReaped: " << iter -> reaped  << "\nStatus: " << iter -> state << endl;
 		cout << "+++++++++\n\n";
 	}
 
 }
 
-void clear_screen (bool run_in_fg, bool redir) {
+void clear_screen (vector<string>& tokens, bool run_in_fg, bool redir) {
 
 	system("clear");
 
@@ -3,12 +3,13 @@
 
 #include <string>
 #include <vector>
-#include <map>
+
+#include "jobs.h"
+#include "spawn.h"
+#include "capture.h"
 
 using std::vector;
 using std::string;
-using std::map;
-using std::pair;
 
 /**
 * A namespace containing all the command functions
@@ -17,52 +18,95 @@ using std::pair;
 namespace ss {
 
 /**
-* The structure that is used to hold information about a process
-* that has been run in the simple shell
+* The processes run in the simple shell, indexed by pid
 */
-struct process {
-	pid_t pid;
-	bool reaped;
-	vector<string> tokens;
-	int state;
-	bool run_in_fg;
+extern job_table ps;
+
+/**
+* Per-job options given with the fg/bg specifier, applied by the launchers to the next job
+*/
+struct job_options {
+	restart_policy restart;
+	supervision history;
+	bool timed; // time prefix
+	job_limits limits; // limit prefix
+	bool pinned; // --cpus or --numa-node given
+	cpu_set_t cpus; // CPUs of a pinned job
+	size_t capture; // ring size of --capture, 0 for none
+	string spill; // spill log of --spill, empty for none
 };
 
 /**
-* Define the function pointer type for the functions supporting commands with arguments
+* Options for the command being run. Reset after every command
 */
-typedef void (*func_ptr) (vector<string>&, bool, bool);
+extern job_options options;
 
 /**
-* Define the function pointer type for the functions supporting commands without arguments
+* Exit status of the last command: the exit code of a foreground child, 128 plus the signal
+* that killed it, or the status a builtin reports
 */
-typedef void (*func_ptr1) (bool, bool);
+extern int last_status;
 
 /**
-* Pairs of supported commands that take arguments and their corresponding functions
+* Reset options to the defaults
 */
-extern map<string, func_ptr> commands; 
+void reset_options ();
 
 /**
-* Pairs of supported commands that do not take arguments and their corresponding functions
+* Record a newly launched child in ps, with the options of the current command.
+* Called with SIGCHLD blocked
+* @param child The pid of the child
+* @param tokens The command the child runs
+* @param run_in_fg Whether the child runs in the foreground
+* @param stages The pids of every stage if the child leads a pipeline
+* @return The new entry
 */
-extern map<string, func_ptr1> commands_wo_args;
+process& add_process (pid_t child, vector<string>& tokens, bool run_in_fg, const vector<pid_t>& stages = vector<pid_t>());
 
 /**
-* A list of all the pid's of processes run in the simple shell
+* Copy the launch timestamps the spawn engine took into a job's entry
+* @param entry The job
+* @param plan The plan it was spawned with
 */
-extern vector<process> ps;
+void record_launch (process& entry, const spawn_plan& plan);
 
 /**
-* Initialize the map of <command, func_ptr> pairs
+* Create the cgroup of the job about to be launched, if the limits of the current command call for one
+* @return The descriptor its processes join through, to be closed once they are spawned, or -1
 */
-void cmd_initialize ();
+int open_limits ();
 
 /**
-* Signal handler that captures the arrival of SIGCHLD
-* @param signum The signal number that arrived
+* Create the pipe the job about to be launched writes its output to, if the current command is captured
+* @param ring Receives the ring the output is kept in, to be stored with the job
+* @return The write end, to be closed once the job's processes are spawned, or -1
 */
-void ch_handler (int signum);
+int open_output (std::shared_ptr<output_ring>& ring);
+
+/**
+* Point a plan at the limits, CPUs and output capture of the current command
+* @param plan The plan of one process of the job, with its redirections in place
+* @param cgroup The descriptor returned by open_limits for the job
+* @param output The descriptor returned by open_output; it takes stderr, and stdout unless the process writes to a pipe
+*/
+void plan_options (spawn_plan& plan, int cgroup, int output);
+
+/**
+* Block until a foreground child terminates and record its exit state in ps.
+* The shell sleeps in poll on the reaper's self-pipe, reaping and restarting background jobs
+* as their notifications arrive, until the foreground child has been reaped
+* @param child The pid of the foreground child
+*/
+void wait_fg (pid_t child);
+
+/**
+* Run a builtin, or any other command as an external program.
+* Redirections of a builtin are applied to the shell's own descriptors while it runs
+* @param tokens A list of the command name, its arguments and its redirections
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the command has redirections or not
+*/
+void run_command (vector<string>& tokens, bool run_in_fg, bool redir = false);
 
 /**
 * Function used to recover a background process
@@ -73,12 +117,13 @@ void ch_handler (int signum);
 void recover (vector<string>& tokens, bool run_in_fg, bool redir);
 
 /**
-* Command that lists the content of the working directory
-* @param tokens A list of the command name and its arguments
+* Launch an external command found through PATH.
+* Its redirection files are opened by the shell before the child is spawned
+* @param tokens A list of the command name, its arguments and its redirections
 * @bool run_in_fg Specifier of whether the process runs in the foreground or not
-* @bool redir Specifier of whether the output should be redirected or not
+* @bool redir Specifier of whether the command has redirections or not
 */
-void ls (vector<string>& tokens, bool run_in_fg, bool redir = false);
+void run_external (vector<string>& tokens, bool run_in_fg, bool redir = false);
 
 /**
 * Command that changes the working directory
@@ -97,19 +142,55 @@ void cd (vector<string>& tokens, bool run_in_fg, bool redir = false);
 */
 void query (vector<string>& tokens, bool run_in_fg, bool redir = false);
 
+/**
+* Command that shows or sets how many reaped processes are kept in ps.
+* Older reaped processes are dropped as new ones are launched
+* @param tokens A list of the command name and an optional new limit
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void retain (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+/**
+* Queue a reaped background job for wait -n. Called by the reaper for every job it collects
+* @param entry The job
+*/
+void job_finished (const process& entry);
+
+/**
+* Drop the parent's jobs in a forked subshell: ps, the finished jobs queued for wait -n
+* and the capture rings. The jobs are not the subshell's children, so it can neither reap nor wait for them
+*/
+void forget_jobs ();
+
+/**
+* Command that waits for background jobs: wait waits for all of them, including jobs waiting
+* out their backoff before a restart, wait <pid>... for the given jobs and wait -n for the oldest job
+* not waited for yet, blocking until one finishes if none has. wait -n <pid>... returns the first of the given jobs to finish. Jobs are checked off by a reap listener as the reaper collects them,
+* so each wakeup costs time in the number of terminated jobs, not in the number running.
+* The exit status is that of the last pid given, or of the job wait -n saw finish;
+* 127 if a pid is unknown or wait -n has nothing to wait for
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void wait_jobs (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
 /**
 * Show the list of all the pid's of processes run in the simple shell
+* @param tokens A list of the command name and its arguments, which are ignored
 * @bool run_in_fg Specifier of whether the process runs in the foreground or not
 * @bool redir Specifier of whether the output should be redirected or not
 */
-void show_pids (bool run_in_fg = true, bool redir = false);
+void show_pids (vector<string>& tokens, bool run_in_fg = true, bool redir = false);
 
 /**
 * Clear the terminal
+* @param tokens A list of the command name and its arguments, which are ignored
 * @bool run_in_fg Specifier of whether the process runs in the foreground or not
 * @bool redir Specifier of whether the output should be redirected or not
 */
-void clear_screen (bool run_in_fg = true, bool redir = false);
+void clear_screen (vector<string>& tokens, bool run_in_fg = true, bool redir = false);
 
 }
 
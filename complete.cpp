@@ -0,0 +1,337 @@
+#include "complete.h"
+#include "cmds.h"
+#include "builtins.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+namespace ss {
+
+/**
+* Command names in a trie. A name provided by several PATH directories is counted once per directory,
+* so directories can be added and removed independently
+*/
+class name_trie {
+
+public:
+	name_trie () : nodes(1) {}
+
+	void insert (const string& name) {
+		uint32_t n = 0;
+		for (string::const_iterator c = name.cbegin(); c != name.cend(); c++) {
+			n = child(n, *c, true);
+		}
+		nodes[n].count++;
+	}
+
+	void remove (const string& name) {
+		uint32_t n = 0;
+		for (string::const_iterator c = name.cbegin(); c != name.cend() && n != none; c++) {
+			n = child(n, *c, false);
+		}
+		if (n != none && nodes[n].count > 0) {
+			nodes[n].count--;
+		}
+	}
+
+	/**
+	* Collect the names below a prefix, in sorted order
+	*/
+	void find (const string& prefix, vector<string>& out) const {
+		uint32_t n = 0;
+		for (string::const_iterator c = prefix.cbegin(); c != prefix.cend() && n != none; c++) {
+			n = const_cast<name_trie*>(this) -> child(n, *c, false);
+		}
+		if (n != none) {
+			string name = prefix;
+			collect(n, name, out);
+		}
+	}
+
+	void clear () {
+		nodes.assign(1, node());
+	}
+
+private:
+	static const uint32_t none = UINT32_MAX;
+
+	struct node {
+		vector<pair<char, uint32_t> > children; // sorted by character
+		unsigned count; // PATH directories providing the name ending here
+		node () : count(0) {}
+	};
+
+	uint32_t child (uint32_t n, char c, bool create) {
+		vector<pair<char, uint32_t> >& children = nodes[n].children;
+		vector<pair<char, uint32_t> >::iterator slot = std::lower_bound(children.begin(), children.end(), std::make_pair(c, uint32_t(0)));
+		if (slot != children.end() && slot -> first == c) {
+			return slot -> second;
+		}
+		if (!create) {
+			return none;
+		}
+		uint32_t fresh = nodes.size();
+		children.insert(slot, std::make_pair(c, fresh));
+		nodes.push_back(node()); // invalidates children, which is not used again
+		return fresh;
+	}
+
+	void collect (uint32_t n, string& name, vector<string>& out) const {
+		if (nodes[n].count > 0) {
+			out.push_back(name);
+		}
+		for (vector<pair<char, uint32_t> >::const_iterator c = nodes[n].children.cbegin(); c != nodes[n].children.cend(); c++) {
+			name.push_back(c -> first);
+			collect(c -> second, name, out);
+			name.pop_back();
+		}
+	}
+
+	vector<node> nodes; // the root is nodes[0]
+
+};
+
+/**
+* What was taken from a PATH directory at its last scan
+*/
+struct scanned_dir {
+	struct timespec mtime;
+	vector<string> names;
+};
+
+static name_trie executables;
+
+static std::unordered_map<string, scanned_dir> scanned;
+
+/**
+* The PATH the trie was built from, in order
+*/
+static string trie_path;
+static vector<string> trie_dirs;
+
+/**
+* List the executables of a directory
+*/
+static void scan (const string& dir, vector<string>& names) {
+
+	DIR* d = opendir(dir.c_str());
+
+	if (d == nullptr) {
+		return;
+	}
+
+	int fd = dirfd(d);
+	struct dirent* entry;
+
+	while ((entry = readdir(d)) != nullptr) {
+
+		if (entry -> d_name[0] == '.' || (entry -> d_type != DT_REG && entry -> d_type != DT_LNK && entry -> d_type != DT_UNKNOWN)) {
+			continue;
+		}
+
+		struct stat st;
+
+		if (fstatat(fd, entry -> d_name, &st, 0) == 0 && S_ISREG(st.st_mode) && (st.st_mode & 0111) != 0) {
+			names.push_back(entry -> d_name);
+		}
+	}
+
+	closedir(d);
+
+}
+
+/**
+* Bring the trie up to date: only directories added to PATH, or modified since their last scan, are read
+*/
+static void refresh () {
+
+	const char* path_env = getenv("PATH");
+	string path = path_env != nullptr ? path_env : "/bin:/usr/bin";
+
+	if (path != trie_path) { // a new PATH: drop directories no longer on it
+
+		vector<string> dirs;
+		size_t begin = 0;
+
+		while (begin <= path.size()) {
+			size_t end = path.find(':', begin);
+			if (end == string::npos) {
+				end = path.size();
+			}
+			string dir = end > begin ? path.substr(begin, end - begin) : ".";
+			if (std::find(dirs.begin(), dirs.end(), dir) == dirs.end()) {
+				dirs.push_back(dir);
+			}
+			begin = end + 1;
+		}
+
+		for (vector<string>::const_iterator old = trie_dirs.cbegin(); old != trie_dirs.cend(); old++) {
+			if (std::find(dirs.begin(), dirs.end(), *old) == dirs.end()) {
+				const vector<string>& names = scanned[*old].names;
+				for (vector<string>::const_iterator name = names.cbegin(); name != names.cend(); name++) {
+					executables.remove(*name);
+				}
+				scanned.erase(*old);
+			}
+		}
+
+		trie_path = path;
+		trie_dirs = dirs;
+	}
+
+	for (vector<string>::const_iterator dir = trie_dirs.cbegin(); dir != trie_dirs.cend(); dir++) {
+
+		struct stat st;
+		bool exists = stat(dir -> c_str(), &st) == 0;
+		std::unordered_map<string, scanned_dir>::iterator known = scanned.find(*dir);
+
+		if (known != scanned.end() && exists && known -> second.mtime.tv_sec == st.st_mtim.tv_sec
+		    && known -> second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+			continue; // unchanged since it was scanned
+		}
+
+		if (known != scanned.end()) { // changed or gone: take its old names out
+			for (vector<string>::const_iterator name = known -> second.names.cbegin(); name != known -> second.names.cend(); name++) {
+				executables.remove(*name);
+			}
+			scanned.erase(known);
+		}
+
+		if (!exists) {
+			continue;
+		}
+
+		scanned_dir& fresh = scanned[*dir];
+		fresh.mtime = st.st_mtim;
+		scan(*dir, fresh.names);
+
+		for (vector<string>::const_iterator name = fresh.names.cbegin(); name != fresh.names.cend(); name++) {
+			executables.insert(*name);
+		}
+	}
+
+}
+
+void complete_command (const string& prefix, vector<string>& matches) {
+
+	refresh();
+	executables.find(prefix, matches);
+
+}
+
+/**
+* Whether a word starts a command inside a construct, like then or do
+*/
+static bool is_keyword (const string& word) {
+
+	static const char* const keywords[] = { "if", "then", "elif", "else", "while", "until", "do" };
+
+	for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+		if (word == keywords[i]) {
+			return true;
+		}
+	}
+
+	return false;
+
+}
+
+/**
+* Split the part of the line before the word into words, starting after the last pipe or ;
+*/
+static vector<string> preceding_words (const string& line, size_t start) {
+
+	vector<string> words;
+	size_t i = 0;
+
+	while (i < start) {
+
+		while (i < start && (line[i] == ' ' || line[i] == '\t')) {
+			++i;
+		}
+
+		size_t begin = i;
+
+		while (i < start && line[i] != ' ' && line[i] != '\t') {
+			++i;
+		}
+
+		if (i > begin) {
+			string word = line.substr(begin, i - begin);
+			if (word == "|" || word[word.size() - 1] == ';') {
+				words.clear(); // a new stage or command
+			} else {
+				words.push_back(word);
+			}
+		}
+	}
+
+	// the job prefixes are not the command
+	while (!words.empty()) {
+		if (words[0] == "limit") { // each of its options takes a value
+			size_t options = 1;
+			while (options + 1 < words.size() && words[options].compare(0, 2, "--") == 0) {
+				options += 2;
+			}
+			words.erase(words.begin(), words.begin() + options);
+		} else if ((words[0] == "--cpus" || words[0] == "--numa-node") && words.size() > 1) { // value given separately
+			words.erase(words.begin(), words.begin() + 2);
+		} else if (words[0] == "fg" || words[0] == "bg" || words[0] == "time" || words[0].compare(0, 2, "--") == 0
+		           || is_keyword(words[0])) {
+			words.erase(words.begin());
+		} else {
+			break;
+		}
+	}
+
+	return words;
+
+}
+
+bool complete_word (const string& line, size_t start, const string& text, vector<string>& matches) {
+
+	if (text.find('/') != string::npos) {
+		return false;
+	}
+
+	vector<string> words = preceding_words(line, start);
+
+	if (words.empty()) { // command position
+
+		vector<string> names = builtin_names();
+
+		for (vector<string>::const_iterator name = names.cbegin(); name != names.cend(); name++) {
+			if (name -> compare(0, text.size(), text) == 0) {
+				matches.push_back(*name);
+			}
+		}
+
+		complete_command(text, matches);
+		std::sort(matches.begin(), matches.end());
+		matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+		return true;
+	}
+
+	if (words[0] == "query" || words[0] == "wait" || words[0] == "output") {
+
+		for (job_table::const_iterator iter = ps.cbegin(); iter != ps.cend(); iter++) {
+			string pid = std::to_string(iter -> pid);
+			if (pid.compare(0, text.size(), text) == 0 && (words[0] == "query" || (words[0] == "output" ? bool(iter -> output) : !iter -> reaped))) {
+				matches.push_back(pid);
+			}
+		}
+
+		std::sort(matches.begin(), matches.end());
+		return true;
+	}
+
+	return false;
+
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef _COMPLETE_H_
+#define _COMPLETE_H_
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Find the completions of the word being typed.
+* In command position these are builtins and the executables on PATH, which are kept in a trie:
+* each PATH directory is scanned once and rescanned only when its mtime changes, so a lookup
+* costs a stat per directory plus the walk below the prefix. The argument of query, wait and
+* output completes to the pids in ps. A word containing a slash, or any other argument, is a file name
+* @param line The line being edited
+* @param start Where the word starts in line
+* @param text The word up to the cursor
+* @param matches Receives the completions, sorted
+* @return false if the word should be completed as a file name instead
+*/
+bool complete_word (const string& line, size_t start, const string& text, vector<string>& matches);
+
+/**
+* Find the executables on PATH starting with a prefix, refreshing the trie first
+* @param prefix The prefix
+* @param matches Receives the names, sorted
+*/
+void complete_command (const string& prefix, vector<string>& matches);
+
+}
+
+#endif
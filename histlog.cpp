@@ -0,0 +1,465 @@
+#include "histlog.h"
+#include "cmds.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+/**
+* The first page of the index
+*/
+struct index_header {
+	char magic[8];
+	uint64_t indexed_bytes;  // length of the log covered by the index, always at the end of a line
+	uint64_t count;          // entries indexed
+	uint32_t block_entries;  // history_block_entries when the index was built
+	uint32_t bloom_bytes;    // history_bloom_bytes when the index was built
+};
+
+static const char index_magic[8] = { 'S', 'S', 'H', 'I', 'D', 'X', '1', '\0' };
+
+/**
+* The header takes a page and every block takes a page: its Bloom filter, then its entries' offsets
+*/
+static const size_t header_size = 4096;
+static const size_t block_size = history_bloom_bytes + history_block_entries * sizeof(uint64_t);
+
+static_assert(block_size == 4096, "history blocks should fill a page");
+
+static int log_fd = -1;
+static int index_fd = -1;
+
+static char* log_map = nullptr;
+static size_t log_mapped = 0;
+
+static char* index_map = nullptr;
+static size_t index_mapped = 0;
+
+/**
+* The part of the index this shell has seen complete, taken under the lock.
+* Other shells may be adding entries beyond it at any time
+*/
+static size_t visible_count = 0;
+static size_t visible_bytes = 0;
+
+static index_header& header () {
+
+	return *reinterpret_cast<index_header*>(index_map);
+
+}
+
+static unsigned char* bloom (size_t block) {
+
+	return reinterpret_cast<unsigned char*>(index_map + header_size + block * block_size);
+
+}
+
+static uint64_t* offsets (size_t block) {
+
+	return reinterpret_cast<uint64_t*>(index_map + header_size + block * block_size + history_bloom_bytes);
+
+}
+
+/**
+* The two filter bits of a trigram
+*/
+static inline void trigram_bits (const char* p, uint32_t& a, uint32_t& b) {
+
+	uint32_t t = static_cast<unsigned char>(p[0]) << 16 | static_cast<unsigned char>(p[1]) << 8 | static_cast<unsigned char>(p[2]);
+	a = (t * 2654435761u) >> 18;
+	b = ((t ^ 0x9e3779b9u) * 0x85ebca6bu) >> 18;
+
+}
+
+/**
+* Map the log up to its current size. A log that shrank, say truncated by another program,
+* is remapped too, since the pages past its end would fault
+*/
+static bool map_log () {
+
+	struct stat st;
+
+	if (fstat(log_fd, &st) == -1) {
+		return false;
+	}
+
+	size_t size = st.st_size;
+
+	if (size == log_mapped) {
+		return true;
+	}
+
+	if (log_map != nullptr) {
+		munmap(log_map, log_mapped);
+		log_map = nullptr;
+		log_mapped = 0;
+	}
+
+	if (size == 0) { // nothing to map
+		return true;
+	}
+
+	void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, log_fd, 0);
+
+	if (p == MAP_FAILED) {
+		return false;
+	}
+
+	log_map = static_cast<char*>(p);
+	log_mapped = size;
+	return true;
+
+}
+
+/**
+* Make sure the index file and its mapping hold at least the given number of blocks.
+* The file grows geometrically, new blocks read as zeros
+*/
+static bool reserve_blocks (size_t blocks) {
+
+	size_t needed = header_size + blocks * block_size;
+
+	struct stat st;
+
+	if (fstat(index_fd, &st) == -1) {
+		return false;
+	}
+
+	size_t size = st.st_size;
+
+	if (size < needed) {
+		size = std::max(needed, size * 2);
+		if (ftruncate(index_fd, size) == -1) {
+			return false;
+		}
+	}
+
+	if (size <= index_mapped) {
+		return true;
+	}
+
+	if (index_map != nullptr) {
+		munmap(index_map, index_mapped);
+		index_map = nullptr;
+		index_mapped = 0;
+	}
+
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, index_fd, 0);
+
+	if (p == MAP_FAILED) {
+		return false;
+	}
+
+	index_map = static_cast<char*>(p);
+	index_mapped = size;
+	return true;
+
+}
+
+/**
+* Drop the whole index, which is rebuilt from the log
+*/
+static bool reset_index () {
+
+	if (index_map != nullptr) {
+		munmap(index_map, index_mapped);
+		index_map = nullptr;
+		index_mapped = 0;
+	}
+
+	if (ftruncate(index_fd, 0) == -1 || !reserve_blocks(1)) {
+		return false;
+	}
+
+	index_header& h = header();
+	memcpy(h.magic, index_magic, sizeof(index_magic));
+	h.indexed_bytes = 0;
+	h.count = 0;
+	h.block_entries = history_block_entries;
+	h.bloom_bytes = history_bloom_bytes;
+	return true;
+
+}
+
+/**
+* Index one entry of the log
+*/
+static bool index_entry (size_t start, size_t end) {
+
+	index_header& h = header();
+	size_t block = h.count / history_block_entries;
+
+	if (!reserve_blocks(block + 1)) {
+		return false;
+	}
+
+	index_header& grown = header(); // the mapping may have moved
+	offsets(block)[grown.count % history_block_entries] = start;
+
+	unsigned char* filter = bloom(block);
+
+	for (size_t i = start; i + 3 <= end; ++i) {
+		uint32_t a, b;
+		trigram_bits(log_map + i, a, b);
+		filter[a >> 3] |= 1 << (a & 7);
+		filter[b >> 3] |= 1 << (b & 7);
+	}
+
+	grown.count++;
+	return true;
+
+}
+
+/**
+* Index the entries appended to the log since the index was last updated.
+* The index is locked meanwhile, so shells sharing the history do not interleave updates
+*/
+static bool catch_up () {
+
+	flock(index_fd, LOCK_EX);
+
+	bool ok = map_log() && reserve_blocks(1);
+
+	if (ok) {
+
+		index_header& h = header();
+
+		if (memcmp(h.magic, index_magic, sizeof(index_magic)) != 0 || h.block_entries != history_block_entries
+		    || h.bloom_bytes != history_bloom_bytes || h.indexed_bytes > log_mapped) { // new, foreign or truncated log
+			ok = reset_index();
+		}
+	}
+
+	if (ok) {
+
+		size_t start = header().indexed_bytes;
+		const char* newline;
+
+		while (ok && start < log_mapped && (newline = static_cast<const char*>(memchr(log_map + start, '\n', log_mapped - start))) != nullptr) {
+			size_t end = newline - log_map;
+			ok = index_entry(start, end);
+			start = end + 1;
+			header().indexed_bytes = start;
+		}
+	}
+
+	if (ok) {
+		visible_count = header().count;
+		visible_bytes = header().indexed_bytes;
+	} else if (visible_bytes > log_mapped) { // never read past the end of a log that shrank
+		visible_count = visible_bytes = 0;
+	}
+
+	flock(index_fd, LOCK_UN);
+
+	return ok;
+
+}
+
+bool history_open (const string& path) {
+
+	history_close();
+
+	log_fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	index_fd = open((path + ".idx").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+	if (log_fd == -1 || index_fd == -1 || !catch_up()) {
+		history_close();
+		return false;
+	}
+
+	return true;
+
+}
+
+void history_close () {
+
+	if (log_map != nullptr) {
+		munmap(log_map, log_mapped);
+	}
+
+	if (index_map != nullptr) {
+		munmap(index_map, index_mapped);
+	}
+
+	if (log_fd != -1) {
+		close(log_fd);
+	}
+
+	if (index_fd != -1) {
+		close(index_fd);
+	}
+
+	log_map = index_map = nullptr;
+	log_mapped = index_mapped = 0;
+	log_fd = index_fd = -1;
+	visible_count = visible_bytes = 0;
+
+}
+
+string history_default_path () {
+
+	const char* path = getenv("SS_HISTFILE");
+
+	if (path != nullptr) {
+		return path;
+	}
+
+	const char* home = getenv("HOME");
+
+	return home != nullptr ? string(home) + "/.simple_shell_history" : string();
+
+}
+
+void history_add (const string& line) {
+
+	if (log_fd == -1 || line.empty() || line.find('\n') != string::npos) {
+		return;
+	}
+
+	string record = line + "\n";
+
+	if (write(log_fd, record.data(), record.size()) == static_cast<ssize_t>(record.size())) { // one write, appended whole
+		catch_up();
+	}
+
+}
+
+size_t history_size () {
+
+	if (log_fd != -1) { // take in other shells' entries, and notice a truncated log before entries are read
+		catch_up();
+	}
+
+	return visible_count;
+
+}
+
+/**
+* The extent of an entry in the log
+*/
+static void extent (size_t i, size_t& start, size_t& end) {
+
+	start = offsets(i / history_block_entries)[i % history_block_entries];
+	end = i + 1 < visible_count ? offsets((i + 1) / history_block_entries)[(i + 1) % history_block_entries] - 1
+	                            : visible_bytes - 1;
+
+}
+
+string history_entry (size_t i) {
+
+	size_t start, end;
+	extent(i, start, end);
+	return string(log_map + start, end - start);
+
+}
+
+long history_search (const string& text, bool prefix, size_t before) {
+
+	size_t n = std::min(before, history_size());
+	vector<uint32_t> bits;
+
+	for (size_t i = 0; i + 3 <= text.size(); ++i) {
+		uint32_t a, b;
+		trigram_bits(text.data() + i, a, b);
+		bits.push_back(a);
+		bits.push_back(b);
+	}
+
+	long i = static_cast<long>(n) - 1;
+
+	while (i >= 0) {
+
+		size_t block = i / history_block_entries;
+		long first = block * history_block_entries;
+		const unsigned char* filter = bloom(block);
+		bool possible = true;
+
+		for (vector<uint32_t>::const_iterator bit = bits.cbegin(); bit != bits.cend() && possible; bit++) {
+			possible = (filter[*bit >> 3] & (1 << (*bit & 7))) != 0;
+		}
+
+		if (!possible) { // no entry of the block has every trigram of the text
+			i = first - 1;
+			continue;
+		}
+
+		for (; i >= first; --i) {
+
+			size_t start, end;
+			extent(i, start, end);
+
+			if (end - start < text.size()) {
+				continue;
+			}
+
+			if (prefix ? memcmp(log_map + start, text.data(), text.size()) == 0
+			           : memmem(log_map + start, end - start, text.data(), text.size()) != nullptr) {
+				return i;
+			}
+		}
+	}
+
+	return -1;
+
+}
+
+void history (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	if (tokens.size() >= 3 && (tokens[1] == "-s" || tokens[1] == "-p")) {
+
+		string text = tokens[2];
+		for (size_t i = 3; i < tokens.size(); ++i) {
+			text += " " + tokens[i];
+		}
+
+		vector<size_t> matches;
+		long found = history_size();
+
+		while ((found = history_search(text, tokens[1] == "-p", found)) != -1) {
+			matches.push_back(found);
+		}
+
+		for (vector<size_t>::const_reverse_iterator iter = matches.crbegin(); iter != matches.crend(); iter++) {
+			cout << "  " << *iter + 1 << "  " << history_entry(*iter) << "\n";
+		}
+
+		cout.flush();
+		return;
+	}
+
+	char* end = nullptr;
+	long count = tokens.size() == 2 ? strtol(tokens[1].c_str(), &end, 10) : 20;
+
+	if (tokens.size() > 2 || (end != nullptr && (*end != '\0' || end == tokens[1].c_str())) || count < 0) {
+		cerr << "Correct form: history [<count> | -s <text> | -p <text>]\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
+
+	size_t size = history_size();
+	size_t first = static_cast<size_t>(count) < size ? size - count : 0;
+
+	for (size_t i = first; i < size; ++i) {
+		cout << "  " << i + 1 << "  " << history_entry(i) << "\n";
+	}
+
+	cout.flush();
+
+}
+
+}
@@ -0,0 +1,84 @@
+#ifndef _HISTLOG_H_
+#define _HISTLOG_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Number of history entries covered by one block of the index
+*/
+const size_t history_block_entries = 256;
+
+/**
+* Size in bytes of the trigram Bloom filter of a block
+*/
+const size_t history_bloom_bytes = 2048;
+
+/**
+* Open the persistent history: an append-only log of command lines and an index file next to it.
+* Both are memory-mapped rather than read. The index holds the offset of every entry and,
+* for each block of entries, a Bloom filter of their trigrams; only entries appended since
+* the index was last brought up to date, by this shell or another one, are indexed here,
+* so opening does not depend on the size of the history
+* @param path The log; the index is <path>.idx
+* @return false if the log cannot be opened or mapped
+*/
+bool history_open (const string& path);
+
+/**
+* Unmap and close the history
+*/
+void history_close ();
+
+/**
+* The default log: $SS_HISTFILE, or ~/.simple_shell_history
+* @return The path, or an empty string if there is no home directory
+*/
+string history_default_path ();
+
+/**
+* Append a command line to the log and the index
+* @param line The line, without a newline
+*/
+void history_add (const string& line);
+
+/**
+* Bring the index up to date with the log, which other shells or programs may have changed
+* @return The number of entries in the history
+*/
+size_t history_size ();
+
+/**
+* @param i The entry number, 0 being the oldest
+* @return The entry
+*/
+string history_entry (size_t i);
+
+/**
+* Search the history backwards. Blocks whose Bloom filter lacks a trigram of the text
+* are skipped without looking at their entries
+* @param text The text to look for
+* @param prefix Whether entries must start with text, rather than contain it
+* @param before Only entries numbered below this are considered
+* @return The number of the newest matching entry, or -1 if there is none
+*/
+long history_search (const string& text, bool prefix, size_t before);
+
+/**
+* Command that shows the history: history [N] prints the last N entries (default 20),
+* history -s <text> every entry containing text and history -p <text> every entry starting with it
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void history (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
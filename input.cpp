@@ -0,0 +1,325 @@
+#include "input.h"
+#include "reaper.h"
+#include "histlog.h"
+#include "complete.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <readline/readline.h>
+#include <readline/history.h>
+
+namespace ss {
+
+/**
+* Where commands are read from: stdin, a script, or -1 once the input is exhausted (-c)
+*/
+static int input_fd = STDIN_FILENO;
+
+/**
+* Size of each read from the input
+*/
+static const size_t input_chunk = 256 * 1024;
+
+/**
+* Input read that has not been returned as a command yet
+*/
+static string input_buffer;
+
+/**
+* Position of the first unread character in input_buffer
+*/
+static size_t input_pos = 0;
+
+/**
+* Prompt of the next terminal read
+*/
+static string prompt;
+
+/**
+* Number of recent history entries handed to readline for the arrow keys
+*/
+static const size_t recent_history = 1000;
+
+/**
+* State of a terminal read: the line readline completed, and whether it did
+*/
+static string editor_line;
+static bool editor_done = false;
+static bool editor_eof = false;
+
+/**
+* The text Ctrl-R looks for, and the entry the last match was found at
+*/
+static string search_text;
+static long search_from = 0;
+
+/**
+* readline callback for a completed line
+*/
+static void line_complete (char* line) {
+
+	editor_done = true;
+	editor_eof = line == nullptr;
+
+	if (line != nullptr) {
+		editor_line = line;
+		free(line);
+	}
+
+	rl_callback_handler_remove(); // no prompt until the next read
+
+}
+
+/**
+* Ctrl-R: replace the line with the newest older history entry containing the text of the line
+* when the search started
+*/
+static int search_history (int count, int key) {
+
+	if (rl_last_func != search_history) { // a new search
+		search_text = rl_line_buffer;
+		search_from = history_size();
+	}
+
+	long found = search_from;
+	string match;
+
+	do { // skip repeats of the entry already shown
+		found = history_search(search_text, false, found);
+		match = found != -1 ? history_entry(found) : string();
+	} while (found != -1 && match == rl_line_buffer && !search_text.empty() && match != search_text);
+
+	if (found == -1) {
+		rl_ding();
+		return 0;
+	}
+
+	search_from = found;
+	rl_replace_line(match.c_str(), 0);
+	rl_point = rl_end;
+
+	return 0;
+
+}
+
+/**
+* Completions of the word being completed, handed out by next_completion
+*/
+static vector<string> completions;
+
+static char* next_completion (const char*, int state) {
+
+	static size_t next;
+
+	if (state == 0) {
+		next = 0;
+	}
+
+	return next < completions.size() ? strdup(completions[next++].c_str()) : nullptr;
+
+}
+
+/**
+* Complete commands and pids ourselves; anything else falls back to readline's file name completion
+*/
+static char** complete (const char* text, int start, int) {
+
+	completions.clear();
+
+	if (!complete_word(rl_line_buffer, start, text, completions)) {
+		return nullptr;
+	}
+
+	rl_attempted_completion_over = 1; // no file names when there is nothing to offer
+	return rl_completion_matches(text, next_completion);
+
+}
+
+/**
+* Set up readline and the persistent history on the first read from a terminal
+*/
+static void start_editor () {
+
+	rl_readline_name = "Simple_Shell";
+	rl_initialize();
+	rl_bind_key(CTRL('r'), search_history);
+	rl_attempted_completion_function = complete;
+
+	string path = history_default_path();
+
+	if (path.empty() || !history_open(path)) {
+		return;
+	}
+
+	size_t size = history_size();
+	for (size_t i = size > recent_history ? size - recent_history : 0; i < size; ++i) {
+		add_history(history_entry(i).c_str());
+	}
+
+}
+
+/**
+* Read a line with readline, reaping children while waiting for keys
+*/
+static bool read_terminal (string& command) {
+
+	static bool started = false;
+
+	if (!started) {
+		start_editor();
+		started = true;
+	}
+
+	bool record = !prompt.empty();
+
+	editor_done = false;
+	rl_callback_handler_install(prompt.c_str(), line_complete);
+	prompt.clear();
+
+	while (!editor_done) {
+
+		struct pollfd pfds[2];
+		pfds[0].fd = STDIN_FILENO;
+		pfds[0].events = POLLIN;
+		pfds[1].fd = reaper_fd();
+		pfds[1].events = POLLIN;
+
+		if (poll(pfds, 2, reaper_timeout()) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("Error waiting for input");
+			rl_callback_handler_remove();
+			return false;
+		}
+
+		reaper_dispatch(); // children terminated or a restart is due
+
+		if (pfds[0].revents != 0) {
+			rl_callback_read_char();
+		}
+	}
+
+	if (editor_eof) {
+		return false;
+	}
+
+	command = editor_line;
+
+	if (record && command.find_first_not_of(" \t") != string::npos && command[0] != ' ') { // a leading blank keeps a line out
+		add_history(command.c_str());
+		history_add(command);
+	}
+
+	return true;
+
+}
+
+void input_prompt (const string& text) {
+
+	prompt = text;
+
+}
+
+bool read_command (string& command) {
+
+	if (input_is_terminal()) {
+		return read_terminal(command);
+	}
+
+	size_t newline;
+
+	while ((newline = input_buffer.find('\n', input_pos)) == string::npos) {
+
+		if (input_fd == -1) { // nothing more to read, return what is left as the last command
+			if (input_pos == input_buffer.size()) {
+				return false;
+			}
+			command = input_buffer.substr(input_pos);
+			input_buffer.clear();
+			input_pos = 0;
+			return true;
+		}
+
+		struct pollfd pfds[2];
+		pfds[0].fd = input_fd;
+		pfds[0].events = POLLIN;
+		pfds[1].fd = reaper_fd();
+		pfds[1].events = POLLIN;
+
+		if (poll(pfds, 2, reaper_timeout()) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("Error waiting for input");
+			return false;
+		}
+
+		reaper_dispatch(); // children terminated or a restart is due
+
+		if (pfds[0].revents != 0) {
+
+			static char buf[input_chunk];
+			ssize_t n = read(input_fd, buf, sizeof(buf));
+
+			if (n == -1 && errno == EINTR) {
+				continue;
+			}
+
+			if (n == 0 && isatty(input_fd)) { // Ctrl-D ends this read only, the terminal stays open
+				if (input_pos == input_buffer.size()) {
+					return false;
+				}
+				command = input_buffer.substr(input_pos);
+				input_buffer.clear();
+				input_pos = 0;
+				return true;
+			}
+
+			if (n <= 0) { // end of input
+				if (input_fd != STDIN_FILENO) {
+					close(input_fd);
+				}
+				input_fd = -1;
+				continue;
+			}
+
+			input_buffer.erase(0, input_pos); // drop consumed lines before growing
+			input_pos = 0;
+			input_buffer.append(buf, n);
+		}
+	}
+
+	reaper_dispatch(); // cheap unless a child terminated
+
+	command.assign(input_buffer, input_pos, newline - input_pos);
+	input_pos = newline + 1;
+
+	return true;
+}
+
+bool input_from_file (const char* path) {
+
+	input_fd = open(path, O_RDONLY | O_CLOEXEC);
+	return input_fd != -1;
+
+}
+
+void input_from_string (const string& text) {
+
+	input_buffer = text;
+	input_pos = 0;
+	input_fd = -1;
+
+}
+
+bool input_is_terminal () {
+
+	return input_fd == STDIN_FILENO && isatty(STDIN_FILENO);
+
+}
+
+}
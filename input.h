@@ -0,0 +1,48 @@
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include <string>
+
+using std::string;
+
+namespace ss {
+
+/**
+* Read commands from a script instead of stdin
+* @param path The script
+* @return false if the script cannot be opened
+*/
+bool input_from_file (const char* path);
+
+/**
+* Take the given text as the whole input (-c)
+* @param text One or more command lines
+*/
+void input_from_string (const string& text);
+
+/**
+* @return Whether commands are typed at a terminal
+*/
+bool input_is_terminal ();
+
+/**
+* Set the prompt shown by the next read from a terminal. It is cleared by the read,
+* and lines read with a prompt are recorded in the history
+* @param prompt The prompt
+*/
+void input_prompt (const string& prompt);
+
+/**
+* Read the next line from the input. At a terminal, lines are edited with readline,
+* Ctrl-R replaces the line with the newest history entry containing it
+* and pressing it again goes on to older ones. While waiting for input, the shell keeps
+* reaping children and launching scheduled restarts.
+* Builtins that take data from the input, like parallel, read it through here as well
+* @param command Receives the line without its trailing newline
+* @return false at the end of input
+*/
+bool read_command (string& command);
+
+}
+
+#endif
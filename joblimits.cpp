@@ -0,0 +1,254 @@
+#include "joblimits.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+void clear_limits (job_limits& limits) {
+
+	limits.cpu_seconds = RLIM_INFINITY;
+	limits.memory = RLIM_INFINITY;
+	limits.nofile = RLIM_INFINITY;
+	limits.renice = false;
+	limits.nice = 0;
+	limits.cpu_max = 0;
+	limits.cgroup.clear();
+
+}
+
+bool has_limits (const job_limits& limits) {
+
+	return limits.cpu_seconds != RLIM_INFINITY || limits.memory != RLIM_INFINITY
+	    || limits.nofile != RLIM_INFINITY || limits.renice || limits.cpu_max != 0;
+
+}
+
+/**
+* Parse a positive count, with a K, M or G suffix if sizes are allowed
+* @return false if the text is not such a number
+*/
+static bool parse_amount (const string& text, bool size, rlim_t& value) {
+
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long n = strtoull(text.c_str(), &end, 10);
+
+	if (errno != 0 || end == text.c_str() || text[0] == '-' || n == 0) {
+		return false;
+	}
+
+	if (size && *end != '\0' && end[1] == '\0') {
+		unsigned shift;
+		switch (*end) {
+			case 'K': case 'k': shift = 10; break;
+			case 'M': case 'm': shift = 20; break;
+			case 'G': case 'g': shift = 30; break;
+			default: return false;
+		}
+		if (n > (ULLONG_MAX >> shift)) { // would wrap
+			return false;
+		}
+		n <<= shift;
+		++end;
+	}
+
+	value = n;
+	return *end == '\0';
+
+}
+
+bool parse_size (const string& text, rlim_t& value) {
+
+	return parse_amount(text, true, value);
+
+}
+
+bool parse_limits (vector<string>& tokens, job_limits& limits) {
+
+	size_t i = 1; // past "limit"
+
+	while (i < tokens.size() && tokens[i].compare(0, 2, "--") == 0) {
+
+		const string& option = tokens[i];
+
+		if (i + 1 == tokens.size()) {
+			cerr << "Missing value for " << option << endl;
+			return false;
+		}
+
+		const string& value = tokens[i + 1];
+		rlim_t amount = 0;
+		bool valid = true;
+
+		if (option == "--cpu") {
+			valid = parse_amount(value, false, limits.cpu_seconds);
+		} else if (option == "--mem") {
+			valid = parse_amount(value, true, limits.memory);
+		} else if (option == "--nofile") {
+			valid = parse_amount(value, false, limits.nofile);
+		} else if (option == "--cpu-max") {
+			valid = parse_amount(value, false, amount) && amount <= 100000;
+			limits.cpu_max = amount;
+		} else if (option == "--nice") {
+			char* end = nullptr;
+			long nice = strtol(value.c_str(), &end, 10);
+			valid = end != value.c_str() && *end == '\0' && nice >= -20 && nice <= 19;
+			limits.renice = true;
+			limits.nice = nice;
+		} else {
+			cerr << "Unknown limit " << option << ". Use --cpu, --mem, --nofile, --nice or --cpu-max.\n";
+			return false;
+		}
+
+		if (!valid) {
+			cerr << "Bad value " << value << " for " << option << endl;
+			return false;
+		}
+
+		i += 2;
+	}
+
+	tokens.erase(tokens.begin(), tokens.begin() + i);
+	return true;
+
+}
+
+int apply_limits (const job_limits& limits) {
+
+	struct rlimit rl;
+
+	if (limits.cpu_seconds != RLIM_INFINITY) {
+		rl.rlim_cur = limits.cpu_seconds; // SIGXCPU at the limit, SIGKILL a second later
+		rl.rlim_max = limits.cpu_seconds + 1;
+		if (setrlimit(RLIMIT_CPU, &rl) != 0) {
+			return errno;
+		}
+	}
+
+	if (limits.memory != RLIM_INFINITY) {
+		rl.rlim_cur = rl.rlim_max = limits.memory;
+		if (setrlimit(RLIMIT_AS, &rl) != 0) {
+			return errno;
+		}
+	}
+
+	if (limits.nofile != RLIM_INFINITY) {
+		rl.rlim_cur = rl.rlim_max = limits.nofile;
+		if (setrlimit(RLIMIT_NOFILE, &rl) != 0) {
+			return errno;
+		}
+	}
+
+	if (limits.renice && setpriority(PRIO_PROCESS, 0, limits.nice) != 0) {
+		return errno;
+	}
+
+	return 0;
+
+}
+
+/**
+* Write a value to a control file of a cgroup
+*/
+static bool write_control (const string& dir, const char* file, const string& value) {
+
+	int fd = open((dir + "/" + file).c_str(), O_WRONLY | O_CLOEXEC);
+
+	if (fd == -1) {
+		return false;
+	}
+
+	bool written = write(fd, value.data(), value.size()) == static_cast<ssize_t>(value.size());
+	close(fd);
+	return written;
+
+}
+
+int open_job_cgroup (job_limits& limits) {
+
+	static unsigned long jobs = 0;
+	const char* root = getenv("SS_CGROUP");
+	struct statfs fs;
+
+	limits.cgroup.clear();
+
+	if (root == nullptr || (limits.memory == RLIM_INFINITY && limits.cpu_max == 0)) {
+		return -1;
+	}
+
+	if (statfs(root, &fs) != 0 || fs.f_type != CGROUP2_SUPER_MAGIC) {
+		cerr << "SS_CGROUP " << root << " is not a cgroup v2 directory, using rlimits only.\n";
+		return -1;
+	}
+
+	string dir = string(root) + "/ss-" + std::to_string(getpid()) + "-" + std::to_string(++jobs);
+
+	if (mkdir(dir.c_str(), 0755) != 0) {
+		perror(("Creating cgroup " + dir).c_str());
+		return -1;
+	}
+
+	limits.cgroup = dir;
+
+	bool configured = (limits.memory == RLIM_INFINITY || write_control(dir, "memory.max", std::to_string(limits.memory)))
+	               && (limits.cpu_max == 0 || write_control(dir, "cpu.max", std::to_string(limits.cpu_max * 1000) + " 100000"));
+
+	int procs = configured ? open((dir + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC) : -1;
+
+	if (procs == -1) { // the controllers may not be enabled for the subtree
+		perror(("Configuring cgroup " + dir).c_str());
+		remove_job_cgroup(limits);
+	}
+
+	return procs;
+
+}
+
+void remove_job_cgroup (job_limits& limits) {
+
+	if (!limits.cgroup.empty()) {
+		rmdir(limits.cgroup.c_str()); // fails harmlessly while processes remain
+		limits.cgroup.clear();
+	}
+
+}
+
+void print_limits (std::ostream& out, const job_limits& limits) {
+
+	out << "Limits:";
+
+	if (limits.cpu_seconds != RLIM_INFINITY) {
+		out << " cpu " << limits.cpu_seconds << "s";
+	}
+	if (limits.memory != RLIM_INFINITY) {
+		out << " mem " << limits.memory;
+	}
+	if (limits.nofile != RLIM_INFINITY) {
+		out << " nofile " << limits.nofile;
+	}
+	if (limits.renice) {
+		out << " nice " << limits.nice;
+	}
+	if (limits.cpu_max != 0) {
+		out << " cpu-max " << limits.cpu_max << "%";
+	}
+	if (!limits.cgroup.empty()) {
+		out << " cgroup " << limits.cgroup;
+	}
+
+	out << endl;
+
+}
+
+}
@@ -0,0 +1,82 @@
+#ifndef _JOBLIMITS_H_
+#define _JOBLIMITS_H_
+
+#include <sys/resource.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Resource limits of a job, given with the limit prefix.
+* The rlimits and the nice value are applied by the child between fork and exec;
+* memory and CPU bandwidth are also enforced by a cgroup v2 when SS_CGROUP names one
+*/
+struct job_limits {
+	rlim_t cpu_seconds; // RLIMIT_CPU, RLIM_INFINITY if not limited
+	rlim_t memory;      // RLIMIT_AS and memory.max in bytes, RLIM_INFINITY if not limited
+	rlim_t nofile;      // RLIMIT_NOFILE, RLIM_INFINITY if not limited
+	bool renice;        // whether nice is set
+	int nice;           // nice value of the job
+	unsigned cpu_max;   // cpu.max bandwidth in percent of one CPU, 0 if not limited
+	string cgroup;      // cgroup the job was placed in, empty if none
+};
+
+/**
+* Reset limits to none
+*/
+void clear_limits (job_limits& limits);
+
+/**
+* @return Whether any limit is set
+*/
+bool has_limits (const job_limits& limits);
+
+/**
+* Consume a limit prefix: limit [--cpu S] [--mem M] [--nofile N] [--nice K] [--cpu-max P]
+* Sizes take an optional K, M or G suffix
+* @param tokens The command, starting with "limit"; the prefix is erased
+* @param limits Receives the limits
+* @return false if an option or its value is not valid, after reporting it
+*/
+bool parse_limits (vector<string>& tokens, job_limits& limits);
+
+/**
+* Parse a positive size with an optional K, M or G suffix
+* @return false if the text is not such a size
+*/
+bool parse_size (const string& text, rlim_t& value);
+
+/**
+* Apply the rlimits and the nice value to the calling process.
+* Only makes system calls, so it is safe in a vforked child
+* @return 0, or the errno of the call that failed
+*/
+int apply_limits (const job_limits& limits);
+
+/**
+* Create a cgroup for a job under $SS_CGROUP and write its memory.max and cpu.max.
+* Nothing is created unless SS_CGROUP is a cgroup v2 directory and a memory or CPU bandwidth limit is set.
+* The child joins by writing "0" to the returned descriptor
+* @param limits The job's limits; cgroup is set to the new directory
+* @return A close-on-exec descriptor of the cgroup's cgroup.procs, or -1
+*/
+int open_job_cgroup (job_limits& limits);
+
+/**
+* Remove the cgroup of a job once its processes are gone
+*/
+void remove_job_cgroup (job_limits& limits);
+
+/**
+* Print the limits of a job on one line, for query
+*/
+void print_limits (std::ostream& out, const job_limits& limits);
+
+}
+
+#endif
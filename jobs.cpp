@@ -0,0 +1,178 @@
+#include "jobs.h"
+#include "shmjobs.h"
+#include <sys/wait.h>
+#include <sys/time.h>
+
+namespace ss {
+
+job_table::job_table () : max_reaped(default_retention), unreaped(0), next_id(1) {
+}
+
+process& job_table::add (const process& p) {
+
+	vector<pid_t> pids = p.stages;
+	if (pids.empty()) {
+		pids.push_back(p.pid);
+	}
+
+	for (vector<pid_t>::const_iterator pid = pids.cbegin(); pid != pids.cend(); pid++) {
+
+		std::unordered_map<pid_t, iterator>::iterator slot = index.find(*pid);
+
+		if (slot != index.end()) { // pid reused after the old entry was reaped
+			erase(slot -> second);
+		}
+	}
+
+	iterator entry = entries.insert(entries.end(), p);
+	entry -> id = next_id++;
+	entry -> shared_slot = UINT32_MAX;
+
+	if (!entry -> reaped) {
+		unreaped++;
+	}
+
+	for (vector<pid_t>::const_iterator pid = pids.cbegin(); pid != pids.cend(); pid++) {
+		index[*pid] = entry;
+	}
+
+	shared_jobs_publish(*entry);
+
+	return *entry;
+
+}
+
+void job_table::erase (iterator entry) {
+
+	vector<pid_t> pids = entry -> stages;
+	if (pids.empty()) {
+		pids.push_back(entry -> pid);
+	}
+
+	for (vector<pid_t>::const_iterator pid = pids.cbegin(); pid != pids.cend(); pid++) {
+
+		std::unordered_map<pid_t, iterator>::iterator slot = index.find(*pid);
+
+		if (slot != index.end() && slot -> second == entry) {
+			index.erase(slot);
+		}
+	}
+
+	if (!entry -> reaped) {
+		unreaped--;
+	}
+
+	shared_jobs_release(*entry);
+	entries.erase(entry);
+
+}
+
+process* job_table::find (pid_t pid) {
+
+	std::unordered_map<pid_t, iterator>::iterator slot = index.find(pid);
+	return slot == index.end() ? nullptr : &*(slot -> second);
+
+}
+
+const process* job_table::find (pid_t pid) const {
+
+	std::unordered_map<pid_t, iterator>::const_iterator slot = index.find(pid);
+	return slot == index.end() ? nullptr : &*(slot -> second);
+
+}
+
+/**
+* Add the resources used by one more process of a job
+*/
+static void add_usage (struct rusage& total, const struct rusage& usage) {
+
+	timeradd(&total.ru_utime, &usage.ru_utime, &total.ru_utime);
+	timeradd(&total.ru_stime, &usage.ru_stime, &total.ru_stime);
+
+	if (usage.ru_maxrss > total.ru_maxrss) { // stages run side by side, report the largest
+		total.ru_maxrss = usage.ru_maxrss;
+	}
+
+	total.ru_minflt += usage.ru_minflt;
+	total.ru_majflt += usage.ru_majflt;
+	total.ru_nvcsw += usage.ru_nvcsw;
+	total.ru_nivcsw += usage.ru_nivcsw;
+
+}
+
+process* job_table::mark_reaped (pid_t pid, int status, const struct rusage* usage) {
+
+	process* entry = find(pid);
+
+	if (entry != nullptr && !entry -> reaped) {
+
+		if (usage != nullptr) {
+			add_usage(entry -> usage, *usage);
+		}
+
+		if (!entry -> last_failed && (entry -> stages.empty() || entry -> stages.back() == pid)) { // the job's status
+
+			if (WIFEXITED(status)) {
+				entry -> state = 0;
+				entry -> exit_code = WEXITSTATUS(status);
+			} else if (WIFSIGNALED(status)) {
+				entry -> state = WTERMSIG(status);
+			}
+		}
+
+		if (entry -> running > 0) {
+			entry -> running--;
+		}
+
+		if (entry -> running == 0) {
+			entry -> reaped = true;
+			unreaped--;
+			reaped_order.push_back(std::make_pair(entry -> pid, entry -> id));
+			shared_jobs_publish(*entry);
+		}
+	}
+
+	return entry;
+
+}
+
+process* job_table::newest () {
+
+	return entries.empty() ? nullptr : &entries.back();
+
+}
+
+void job_table::set_retention (size_t max_reaped) {
+
+	this -> max_reaped = max_reaped;
+	trim();
+
+}
+
+void job_table::clear () {
+
+	entries.clear();
+	index.clear();
+	reaped_order.clear();
+	unreaped = 0;
+
+}
+
+void job_table::trim () {
+
+	while (reaped_order.size() > max_reaped) {
+
+		pair<pid_t, unsigned long> oldest = reaped_order.front();
+		reaped_order.pop_front();
+
+		std::unordered_map<pid_t, iterator>::iterator slot = index.find(oldest.first);
+
+		// the pid may belong to a newer job by now
+		if (slot != index.end() && slot -> second -> id == oldest.second) {
+			erase(slot -> second);
+		}
+	}
+
+}
+
+}
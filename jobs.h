@@ -0,0 +1,174 @@
+#ifndef _JOBS_H_
+#define _JOBS_H_
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <utility>
+#include <unordered_map>
+#include <memory>
+
+#include "joblimits.h"
+
+using std::vector;
+using std::string;
+using std::pair;
+
+namespace ss {
+
+struct output_ring;
+
+/**
+* When a terminated background process is restarted by the supervisor
+*/
+enum restart_policy {
+	restart_never,      // never restart
+	restart_on_signal,  // killed by a signal other than SIGSEGV or SIGKILL (the default)
+	restart_on_failure, // killed by any signal or exited with a non-zero code
+	restart_always      // whenever it terminates
+};
+
+/**
+* Restart history of a supervised job, carried over from one incarnation to the next
+*/
+struct supervision {
+	unsigned restarts;   // restarts within the current window
+	double window_start; // monotonic time at which the current window began
+	unsigned backoff_ms; // delay before the next restart
+};
+
+/**
+* The structure that is used to hold information about a process
+* that has been run in the simple shell
+*/
+struct process {
+	pid_t pid;
+	bool reaped;
+	vector<string> tokens;
+	int state;
+	bool run_in_fg;
+	unsigned long id; // unique job number, assigned by the job table
+	int exit_code; // exit code if the process exited normally, -1 otherwise
+	restart_policy restart;
+	supervision history;
+	vector<pid_t> stages; // pids of every stage of a pipeline that launched, in order, empty for a single command
+	bool last_failed; // the last stage of a pipeline did not launch, so the job's status is 127
+	unsigned running; // processes of the job not reaped yet
+	struct rusage usage; // resources used by the reaped processes of the job, from wait4
+	double launched; // monotonic time the first process was forked
+	double exec_latency; // seconds from the first fork until the last process exec'd, -1 if unknown
+	double finished; // monotonic time the job was reaped
+	bool timed; // print a timing report when reaped (time prefix)
+	job_limits limits; // resource limits (limit prefix)
+	bool pinned; // whether the job was given its CPUs (--cpus, --numa-node)
+	cpu_set_t cpus; // the CPUs a pinned job runs on
+	uint32_t shared_slot; // its record in the shared-memory job table, UINT32_MAX if none
+	std::shared_ptr<output_ring> output; // captured stdout and stderr (--capture), or empty
+};
+
+/**
+* The table of processes run in the simple shell.
+* Entries are kept in launch order and indexed by pid, so lookups by pid are constant time.
+* A pipeline is a single entry keyed by its first stage and indexed by the pid of every stage.
+* Only the most recently reaped entries are retained; older ones are evicted by trim after jobs are reaped,
+* which keeps memory flat for long-lived shells.
+* The table is only touched from the main loop, never from a signal handler
+*/
+class job_table {
+
+public:
+	typedef std::list<process>::iterator iterator;
+	typedef std::list<process>::const_iterator const_iterator;
+
+	/**
+	* Default number of reaped entries retained
+	*/
+	static const size_t default_retention = 1000;
+
+	job_table ();
+
+	/**
+	* Add a newly launched process.
+	* A reaped entry whose pid has been reused by the kernel is replaced
+	* @param p The process to add; its id is assigned here
+	* @return The stored entry
+	*/
+	process& add (const process& p);
+
+	/**
+	* Look up a process by pid
+	* @param pid The pid to look up
+	* @return The entry, or nullptr if the shell has no (retained) process of that pid
+	*/
+	process* find (pid_t pid);
+	const process* find (pid_t pid) const;
+
+	/**
+	* Record that a process has been reaped. A pipeline is reaped once all of its stages are,
+	* and takes the status of its last stage. The entry stays valid until the next call to trim
+	* @param pid The pid returned by wait4
+	* @param status The status returned by wait4
+	* @param usage The resource usage returned by wait4, added to the job's, or nullptr
+	* @return The updated entry, or nullptr if the pid is unknown
+	*/
+	process* mark_reaped (pid_t pid, int status, const struct rusage* usage = nullptr);
+
+	/**
+	* Evict the oldest reaped entries beyond the retention limit
+	*/
+	void trim ();
+
+	/**
+	* @return The most recently added entry, or nullptr if the table is empty
+	*/
+	process* newest ();
+
+	/**
+	* Set how many reaped entries are retained. Takes effect immediately
+	* @param max_reaped The number of reaped entries to keep
+	*/
+	void set_retention (size_t max_reaped);
+
+	/**
+	* Forget every entry without touching the processes, for a forked subshell
+	* whose parent's jobs are not its children
+	*/
+	void clear ();
+
+	/**
+	* @return The number of jobs that have not been reaped yet, kept up to date as jobs come and go
+	*/
+	size_t live () const { return unreaped; }
+
+	size_t retention () const { return max_reaped; }
+	size_t size () const { return entries.size(); }
+	bool empty () const { return entries.empty(); }
+
+	iterator begin () { return entries.begin(); }
+	iterator end () { return entries.end(); }
+	const_iterator cbegin () const { return entries.cbegin(); }
+	const_iterator cend () const { return entries.cend(); }
+
+private:
+	/**
+	* Remove an entry and every index slot that still refers to it
+	*/
+	void erase (iterator entry);
+
+	std::list<process> entries; // in launch order
+	std::unordered_map<pid_t, iterator> index;
+	std::deque<pair<pid_t, unsigned long> > reaped_order; // (pid, id) in the order entries were reaped
+	size_t max_reaped;
+	size_t unreaped;
+	unsigned long next_id;
+
+};
+
+}
+
+#endif
@@ -0,0 +1,327 @@
+#include "jobtop.h"
+#include "cmds.h"
+#include "reaper.h"
+#include "procstat.h"
+#include "input.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+/**
+* A process being watched: its open /proc/<pid>/stat and its CPU ticks at the previous sample
+*/
+struct watched_proc {
+	int fd;                 // -1 if it is reopened on every sample
+	unsigned long ticks;    // utime + stime
+	double when;            // monotonic time of the previous sample
+	unsigned long job;      // id of the job it belongs to, to tell a reused pid apart
+};
+
+static std::unordered_map<pid_t, watched_proc> watched;
+
+/**
+* Descriptors left free for everything else the shell does
+*/
+static const rlim_t spare_fds = 64;
+
+/**
+* @return How many /proc descriptors may be kept open
+*/
+static size_t fd_budget () {
+
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) {
+		return 1024;
+	}
+
+	return rl.rlim_cur > spare_fds ? rl.rlim_cur - spare_fds : 0;
+
+}
+
+static void forget (std::unordered_map<pid_t, watched_proc>::iterator proc) {
+
+	if (proc -> second.fd != -1) {
+		close(proc -> second.fd);
+	}
+
+	watched.erase(proc);
+
+}
+
+/**
+* Read the stat of one process of a job through its kept descriptor
+* @return false if the process is gone
+*/
+static bool read_stat (pid_t pid, watched_proc& proc, proc_stat& st, size_t& opened) {
+
+	char buf[1024];
+	ssize_t n = -1;
+
+	if (proc.fd != -1) {
+		n = pread(proc.fd, buf, sizeof(buf) - 1, 0);
+	} else {
+		char path[32];
+		snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		opened++;
+		if (fd != -1) {
+			n = read(fd, buf, sizeof(buf) - 1);
+			close(fd);
+		}
+	}
+
+	if (n <= 0) {
+		return false;
+	}
+
+	buf[n] = '\0';
+	return parse_proc_stat(buf, n, st);
+
+}
+
+size_t sample_jobs (vector<job_sample>& samples) {
+
+	static long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+
+	size_t opened = 0;
+	size_t budget = fd_budget();
+	size_t kept = 0;
+	double now = monotonic_now();
+
+	samples.clear();
+
+	for (std::unordered_map<pid_t, watched_proc>::const_iterator proc = watched.cbegin(); proc != watched.cend(); proc++) {
+		kept += proc -> second.fd != -1;
+	}
+
+	for (job_table::const_iterator job = ps.cbegin(); job != ps.cend(); job++) {
+
+		if (job -> reaped) {
+			continue;
+		}
+
+		job_sample sample;
+		sample.pid = job -> pid;
+		sample.id = job -> id;
+		sample.state = '?';
+		sample.cpu_percent = 0;
+		sample.rss_kb = 0;
+		sample.runtime = now - job -> launched;
+
+		for (vector<string>::const_iterator token = job -> tokens.cbegin(); token != job -> tokens.cend(); token++) {
+			sample.command += (sample.command.empty() ? "" : " ") + *token;
+		}
+
+		vector<pid_t> pids = job -> stages;
+		if (pids.empty()) {
+			pids.push_back(job -> pid);
+		}
+
+		for (vector<pid_t>::const_iterator pid = pids.cbegin(); pid != pids.cend(); pid++) {
+
+			std::unordered_map<pid_t, watched_proc>::iterator proc = watched.find(*pid);
+
+			if (proc != watched.end() && proc -> second.job != job -> id) { // the pid was reused
+				kept -= proc -> second.fd != -1;
+				forget(proc);
+				proc = watched.end();
+			}
+
+			bool fresh = proc == watched.end();
+
+			if (fresh) { // first sight: open it once, if there is room
+				watched_proc p = { -1, 0, job -> launched, job -> id };
+				if (kept < budget) {
+					char path[32];
+					snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(*pid));
+					p.fd = open(path, O_RDONLY | O_CLOEXEC);
+					opened++;
+					kept += p.fd != -1;
+				}
+				proc = watched.insert(std::make_pair(*pid, p)).first;
+			}
+
+			proc_stat st;
+
+			if (!read_stat(*pid, proc -> second, st, opened)) {
+				continue; // exited, not reaped yet
+			}
+
+			unsigned long ticks = st.utime + st.stime;
+			double interval = now - proc -> second.when;
+
+			if (interval > 0) {
+				sample.cpu_percent += 100.0 * (ticks - proc -> second.ticks) * seconds_per_tick() / interval;
+			}
+
+			proc -> second.ticks = ticks;
+			proc -> second.when = now;
+			sample.rss_kb += st.rss * page_kb;
+
+			if (sample.state == '?') {
+				sample.state = st.state;
+			}
+		}
+
+		samples.push_back(sample);
+	}
+
+	// processes of jobs reaped since the previous sample
+	for (std::unordered_map<pid_t, watched_proc>::iterator proc = watched.begin(); proc != watched.end(); ) {
+		const process* job = ps.find(proc -> first);
+		if (job == nullptr || job -> reaped || job -> id != proc -> second.job) {
+			std::unordered_map<pid_t, watched_proc>::iterator gone = proc++;
+			forget(gone);
+		} else {
+			proc++;
+		}
+	}
+
+	std::stable_sort(samples.begin(), samples.end(), [] (const job_sample& a, const job_sample& b) {
+		return a.cpu_percent > b.cpu_percent;
+	});
+
+	return opened;
+
+}
+
+void stop_sampling () {
+
+	while (!watched.empty()) {
+		forget(watched.begin());
+	}
+
+}
+
+/**
+* Print one refresh, cut to the height of the terminal if there is one
+*/
+static void draw (const vector<job_sample>& samples, double scan_time, size_t opened, bool tty) {
+
+	struct winsize size;
+	size_t rows = samples.size();
+
+	if (tty && ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 3) {
+		rows = std::min(rows, size_t(size.ws_row - 3));
+		cout << "\033[H\033[2J"; // home and clear, so the table is redrawn in place
+	}
+
+	char line[256];
+
+	snprintf(line, sizeof(line), "jobtop: %zu live jobs, sampled in %.2f ms, %zu files opened", samples.size(), scan_time * 1e3, opened);
+	cout << line << "\n";
+	snprintf(line, sizeof(line), "%8s %7s %5s %7s %10s %10s  %s", "PID", "JOB", "STATE", "CPU%", "RSS", "TIME", "COMMAND");
+	cout << line << "\n";
+
+	for (size_t i = 0; i < rows; ++i) {
+		const job_sample& s = samples[i];
+		snprintf(line, sizeof(line), "%8d %7lu %5c %7.1f %8ldkB %9.1fs  %.80s", s.pid, s.id, s.state, s.cpu_percent, s.rss_kb, s.runtime, s.command.c_str());
+		cout << line << "\n";
+	}
+
+	if (!tty) {
+		cout << "\n"; // frames follow one another
+	}
+
+	cout.flush();
+
+}
+
+void jobtop (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	double interval = 1;
+	long refreshes = -1; // until q
+
+	for (size_t i = 1; i < tokens.size(); i += 2) {
+
+		char* end = nullptr;
+		double value = i + 1 < tokens.size() ? strtod(tokens[i + 1].c_str(), &end) : 0;
+		bool valid = end != nullptr && end != tokens[i + 1].c_str() && *end == '\0' && value > 0;
+
+		if (tokens[i] == "-d" && valid) {
+			interval = value;
+		} else if (tokens[i] == "-n" && valid && value == long(value)) {
+			refreshes = value;
+		} else {
+			cerr << "Correct form: jobtop [-d <seconds>] [-n <refreshes>]\n";
+			last_status = EXIT_FAILURE;
+			return;
+		}
+	}
+
+	bool tty = isatty(STDOUT_FILENO);
+	bool keys = input_is_terminal() && isatty(STDIN_FILENO); // never read a script's commands as keys
+	struct termios saved;
+
+	if (keys && tcgetattr(STDIN_FILENO, &saved) == 0) { // q without Enter
+		struct termios raw = saved;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_cc[VMIN] = 0;
+		raw.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+	} else {
+		keys = false;
+	}
+
+	if (refreshes < 0 && !keys) {
+		refreshes = 1; // nothing could stop it otherwise
+	}
+
+	vector<job_sample> samples;
+	sample_jobs(samples); // the baseline the first CPU figures are measured from
+	bool quit = false;
+
+	for (long n = 0; !quit && (refreshes < 0 || n < refreshes); ++n) {
+
+		// sleep until the next refresh, reaping as children terminate
+		double next = monotonic_now() + interval;
+
+		for (double left = interval; left > 0 && !quit; left = next - monotonic_now()) {
+
+			struct pollfd fds[2] = { { reaper_fd(), POLLIN, 0 }, { STDIN_FILENO, POLLIN, 0 } };
+			int timeout = reaper_timeout();
+			int wait_ms = int(left * 1000) + 1;
+
+			poll(fds, keys ? 2 : 1, timeout >= 0 && timeout < wait_ms ? timeout : wait_ms);
+			reaper_dispatch();
+
+			char key;
+			if (keys && (fds[1].revents & POLLIN) && read(STDIN_FILENO, &key, 1) == 1 && (key == 'q' || key == 'Q')) {
+				quit = true;
+			}
+		}
+
+		if (quit) {
+			break;
+		}
+
+		double start = monotonic_now();
+		size_t opened = sample_jobs(samples);
+		draw(samples, monotonic_now() - start, opened, tty);
+	}
+
+	if (keys) {
+		tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+	}
+
+	stop_sampling();
+
+}
+
+}
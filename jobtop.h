@@ -0,0 +1,52 @@
+#ifndef _JOBTOP_H_
+#define _JOBTOP_H_
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* One live job as sampled by jobtop
+*/
+struct job_sample {
+	pid_t pid;          // the job's pid, or its first stage's
+	unsigned long id;   // job number
+	char state;         // state of its first readable process, '?' if none could be read
+	double cpu_percent; // CPU used by all its processes since the previous sample, in percent of one CPU
+	long rss_kb;        // resident memory of all its processes
+	double runtime;     // seconds since it was launched
+	string command;
+};
+
+/**
+* Sample the live jobs in ps. The /proc/<pid>/stat of every process is opened once and kept open,
+* so a refresh costs one pread per process; descriptors of jobs that were reaped are closed.
+* Processes beyond what the descriptor limit leaves room for are opened and closed on every sample
+* @param samples Receives the jobs, most CPU first
+* @return The number of /proc files that had to be opened for this sample
+*/
+size_t sample_jobs (vector<job_sample>& samples);
+
+/**
+* Close every /proc descriptor kept by sample_jobs
+*/
+void stop_sampling ();
+
+/**
+* Command that shows the live jobs with their CPU use, memory, state and runtime, refreshed in place.
+* jobtop [-d seconds] [-n refreshes]: refreshes every second until q is pressed, or n times.
+* Jobs are reaped as usual while it runs
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void jobtop (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+#include "lexer.h"
+#include <cstring>
+
+namespace ss {
+
+bool word::is (const char* op) const {
+
+	return !quoted && strlen(op) == length && memcmp(op, text, length) == 0;
+
+}
+
+const char* substitution_end (const char* p, const char* end) {
+
+	if (*p == '`') {
+		for (const char* q = p + 1; q < end; ++q) {
+			if (*q == '\\') {
+				++q;
+			} else if (*q == '`') {
+				return q;
+			}
+		}
+		return nullptr;
+	}
+
+	int depth = 1;
+	char quote = 0;
+
+	for (const char* q = p + 2; q < end; ++q) {
+
+		char c = *q;
+
+		if (quote == '\'') {
+			if (c == '\'') {
+				quote = 0;
+			}
+			continue;
+		}
+
+		if (c == '\\') {
+			++q;
+			continue;
+		}
+
+		if ((c == '$' && q + 1 < end && q[1] == '(') || c == '`') { // nested
+			q = substitution_end(q, end);
+			if (q == nullptr) {
+				return nullptr;
+			}
+			continue;
+		}
+
+		if (quote == '"') {
+			if (c == '"') {
+				quote = 0;
+			}
+			continue;
+		}
+
+		if (c == '\'' || c == '"') {
+			quote = c;
+		} else if (c == '(') {
+			++depth;
+		} else if (c == ')' && --depth == 0) {
+			return q;
+		}
+	}
+
+	return nullptr;
+
+}
+
+/**
+* Copy a quoted word into out without its quotes and escapes
+* @return The length of the unescaped word, at most end - begin
+*/
+static size_t unescape (const char* begin, const char* end, char* out) {
+
+	char* dst = out;
+	char quote = 0;
+
+	for (const char* p = begin; p < end; ++p) {
+
+		char c = *p;
+
+		if (quote == '\'') {
+			if (c == '\'') {
+				quote = 0;
+			} else {
+				*dst++ = c;
+			}
+			continue;
+		}
+
+		if (c == '\\' && p + 1 < end) {
+			char next = p[1];
+			if (quote == '"' && next != '\\' && next != '"' && next != '$' && next != '`') {
+				*dst++ = c; // backslash is literal inside double quotes
+			} else {
+				*dst++ = next;
+				++p;
+			}
+			continue;
+		}
+
+		if (quote == '"') {
+			if (c == '"') {
+				quote = 0;
+			} else {
+				*dst++ = c;
+			}
+			continue;
+		}
+
+		if (c == '\'' || c == '"') {
+			quote = c;
+		} else {
+			*dst++ = c;
+		}
+	}
+
+	return dst - out;
+
+}
+
+/**
+* Whether a $ starts a variable reference: $name, ${name}, $? or $$
+*/
+static bool is_reference (const char* p, const char* end) {
+
+	return p + 1 < end && (is_name_start(p[1]) || p[1] == '{' || p[1] == '?' || p[1] == '$');
+
+}
+
+bool lex (const char* line, size_t length, vector<word>& words, arena& scratch, bool script) {
+
+	const char* p = line;
+	const char* end = line + length;
+
+	while (true) {
+
+		while (p < end && is_blank(*p) && !(script && *p == '\n')) { // skip runs of blanks
+			++p;
+		}
+
+		if (p < end && script && *p == '#') { // a comment runs to the end of the line
+			while (p < end && *p != '\n') {
+				++p;
+			}
+		}
+
+		if (p == end) {
+			return true;
+		}
+
+		if (script && (*p == ';' || *p == '\n')) { // a command separator
+			word separator;
+			separator.text = p++;
+			separator.length = 1;
+			separator.quoted = false;
+			separator.substitution = false;
+			words.push_back(separator);
+			continue;
+		}
+
+		const char* start = p;
+		bool plain = true;
+		bool substituted = false;
+		char quote = 0;
+
+		for (; p < end; ++p) { // find the end of the word
+
+			char c = *p;
+
+			if (quote == '\'') {
+				if (c == '\'') {
+					quote = 0;
+				}
+				continue;
+			}
+
+			if (c == '\\') {
+				plain = false;
+				if (p + 1 < end) {
+					++p; // the escaped character never ends the word
+				}
+				continue;
+			}
+
+			if ((c == '$' && p + 1 < end && p[1] == '(') || c == '`') { // blanks inside do not end the word
+				p = substitution_end(p, end);
+				if (p == nullptr) {
+					return false;
+				}
+				plain = false;
+				substituted = true;
+				continue;
+			}
+
+			if (script && c == '$' && is_reference(p, end)) { // expanded when the command runs
+				plain = false;
+				substituted = true;
+				continue;
+			}
+
+			if (quote == '"') {
+				if (c == '"') {
+					quote = 0;
+				}
+				continue;
+			}
+
+			if (c == '\'' || c == '"') {
+				quote = c;
+				plain = false;
+				continue;
+			}
+
+			if (is_blank(c) || (script && c == ';')) {
+				break;
+			}
+		}
+
+		if (quote != 0) {
+			return false; // unterminated quote
+		}
+
+		word w;
+
+		w.substitution = substituted;
+
+		if (plain || substituted) { // view into the input
+			w.text = start;
+			w.length = p - start;
+			w.quoted = substituted;
+		} else {
+			char* out = scratch.allocate(p - start);
+			w.text = out;
+			w.length = unescape(start, p, out);
+			w.quoted = true;
+		}
+
+		words.push_back(w);
+	}
+
+}
+
+}
@@ -0,0 +1,84 @@
+#ifndef _LEXER_H_
+#define _LEXER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* A word of a command line. It points into the input buffer
+* unless quotes or escapes had to be removed, in which case it points into an arena
+*/
+struct word {
+	const char* text;
+	size_t length;
+	bool quoted; // contained quotes or backslashes, so it is never taken as an operator
+	bool substitution; // contains $(...) or `...`, or in scripts a variable; text is then the word as written, to be expanded
+
+	string str () const { return string(text, length); }
+	bool is (const char* op) const;
+};
+
+/**
+* Whether a character separates words
+*/
+inline bool is_blank (char c) {
+
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+
+}
+
+/**
+* Whether a character may start a variable name
+*/
+inline bool is_name_start (char c) {
+
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+
+}
+
+/**
+* Whether a character may continue a variable name
+*/
+inline bool is_name_char (char c) {
+
+	return is_name_start(c) || (c >= '0' && c <= '9');
+
+}
+
+/**
+* Find the end of a command substitution, honouring quotes and nested substitutions inside it
+* @param p Start of the substitution: the $ of $( or an opening backtick
+* @param end End of the input
+* @return The closing ) or backtick, or nullptr if the substitution is not closed
+*/
+const char* substitution_end (const char* p, const char* end);
+
+/**
+* Split a command line into words in a single pass.
+* Words are separated by runs of spaces and tabs. Single quotes preserve everything up to the
+* closing quote; double quotes preserve everything but backslash escapes of backslash, ", $ and `;
+* outside quotes a backslash escapes the next character. A command substitution never
+* ends a word; words containing one are left as written for expansion.
+* Plain words are views into line; only words that need unescaping are copied into scratch.
+* For scripts, an unquoted ; or newline is a word of its own that separates commands,
+* # starts a comment and words referring to variables are left as written for expansion
+* @param line The command line
+* @param length Length of the command line
+* @param words Receives the words
+* @param scratch Arena holding the unescaped words
+* @param script Whether to lex the line as a script
+* @return false if a quote or a substitution is left open
+*/
+bool lex (const char* line, size_t length, vector<word>& words, arena& scratch, bool script = false);
+
+}
+
+#endif
@@ -0,0 +1,429 @@
+#include "ls.h"
+#include "cmds.h"
+#include "arena.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <climits>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+/**
+* Size of the buffer each getdents64 call fills
+*/
+static const size_t dents_buffer_size = 1 << 20;
+
+/**
+* Files modified longer ago than this are shown with their year, as ls does
+*/
+static const time_t half_year = 31556952 / 2;
+
+/**
+* The record getdents64 returns for each entry
+*/
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1]; // null-terminated, runs to d_reclen
+};
+
+/**
+* An entry being listed. The first bytes of the name are kept in the entry itself,
+* so most comparisons during the sort never touch the arena
+*/
+struct dir_entry {
+	uint64_t prefix; // first eight bytes of the name, big-endian, zero padded
+	const char* name;
+	size_t length;
+};
+
+struct list_options {
+	bool all;      // -a: include . and ..
+	bool almost;   // -A: include other hidden names
+	bool unsorted; // -U: directory order
+	bool one;      // -1
+	bool long_format; // -l
+};
+
+/**
+* Names of the entries being listed, reused by every listing
+*/
+static arena names(1 << 20);
+
+static bool entry_less (const dir_entry& a, const dir_entry& b) {
+
+	if (a.prefix != b.prefix) {
+		return a.prefix < b.prefix;
+	}
+
+	return strcmp(a.name, b.name) < 0;
+
+}
+
+/**
+* Copy a name into the arena and describe it
+*/
+static dir_entry make_entry (const char* name, size_t length) {
+
+	dir_entry entry;
+	char* copy = names.allocate(length + 1);
+	memcpy(copy, name, length + 1);
+
+	entry.prefix = 0;
+	for (size_t i = 0; i < sizeof(entry.prefix); ++i) {
+		entry.prefix = entry.prefix << 8 | (i < length ? static_cast<unsigned char>(name[i]) : 0);
+	}
+
+	entry.name = copy;
+	entry.length = length;
+	return entry;
+
+}
+
+/**
+* Parse the options of ls
+* @return false if an option is not handled natively
+*/
+static bool parse_options (const vector<string>& tokens, list_options& opts, vector<string>& paths) {
+
+	memset(&opts, 0, sizeof(opts));
+
+	for (vector<string>::const_iterator iter = tokens.cbegin() + 1; iter != tokens.cend(); iter++) {
+
+		if ((*iter)[0] != '-' || *iter == "-") {
+			paths.push_back(*iter);
+			continue;
+		}
+
+		for (size_t i = 1; i < iter -> size(); ++i) {
+			switch ((*iter)[i]) {
+				case 'a': opts.all = true; break;
+				case 'A': opts.almost = true; break;
+				case 'U': opts.unsorted = true; break;
+				case '1': opts.one = true; opts.long_format = false; break;
+				case 'l': opts.long_format = true; opts.one = false; break;
+				default: return false;
+			}
+		}
+	}
+
+	return true;
+
+}
+
+/**
+* Read every entry of a directory with getdents64
+* @return false, with errno set, if the directory cannot be read
+*/
+static bool read_entries (int dir, const list_options& opts, vector<dir_entry>& entries) {
+
+	static char* buffer = new char[dents_buffer_size];
+
+	while (true) {
+
+		long n = syscall(SYS_getdents64, dir, buffer, dents_buffer_size);
+
+		if (n == 0) {
+			return true;
+		}
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		for (long offset = 0; offset < n; ) {
+
+			const linux_dirent64* dent = reinterpret_cast<const linux_dirent64*>(buffer + offset);
+			offset += dent -> d_reclen;
+
+			const char* name = dent -> d_name;
+
+			if (name[0] == '.') {
+				bool dots = name[1] == '\0' || (name[1] == '.' && name[2] == '\0');
+				if (dots ? !opts.all : !(opts.all || opts.almost)) {
+					continue;
+				}
+			}
+
+			entries.push_back(make_entry(name, strlen(name)));
+		}
+	}
+
+}
+
+/**
+* Append the permission string ls -l shows
+*/
+static void append_mode (string& out, mode_t mode) {
+
+	char type = '-';
+
+	if (S_ISDIR(mode)) type = 'd';
+	else if (S_ISLNK(mode)) type = 'l';
+	else if (S_ISCHR(mode)) type = 'c';
+	else if (S_ISBLK(mode)) type = 'b';
+	else if (S_ISFIFO(mode)) type = 'p';
+	else if (S_ISSOCK(mode)) type = 's';
+
+	char bits[11] = {
+		type,
+		mode & S_IRUSR ? 'r' : '-', mode & S_IWUSR ? 'w' : '-',
+		mode & S_ISUID ? (mode & S_IXUSR ? 's' : 'S') : (mode & S_IXUSR ? 'x' : '-'),
+		mode & S_IRGRP ? 'r' : '-', mode & S_IWGRP ? 'w' : '-',
+		mode & S_ISGID ? (mode & S_IXGRP ? 's' : 'S') : (mode & S_IXGRP ? 'x' : '-'),
+		mode & S_IROTH ? 'r' : '-', mode & S_IWOTH ? 'w' : '-',
+		mode & S_ISVTX ? (mode & S_IXOTH ? 't' : 'T') : (mode & S_IXOTH ? 'x' : '-'),
+		'\0'
+	};
+
+	out += bits;
+
+}
+
+/**
+* User and group names, looked up once per listing
+*/
+static const string& user_name (uid_t uid, std::unordered_map<unsigned, string>& cache) {
+
+	std::unordered_map<unsigned, string>::iterator hit = cache.find(uid);
+
+	if (hit == cache.end()) {
+		struct passwd* pw = getpwuid(uid);
+		hit = cache.insert(std::make_pair(uid, pw != nullptr ? string(pw -> pw_name) : std::to_string(uid))).first;
+	}
+
+	return hit -> second;
+
+}
+
+static const string& group_name (gid_t gid, std::unordered_map<unsigned, string>& cache) {
+
+	std::unordered_map<unsigned, string>::iterator hit = cache.find(gid);
+
+	if (hit == cache.end()) {
+		struct group* gr = getgrgid(gid);
+		hit = cache.insert(std::make_pair(gid, gr != nullptr ? string(gr -> gr_name) : std::to_string(gid))).first;
+	}
+
+	return hit -> second;
+
+}
+
+/**
+* Append a field padded on the left to width
+*/
+static void append_right (string& out, const string& field, size_t width) {
+
+	if (field.size() < width) {
+		out.append(width - field.size(), ' ');
+	}
+	out += field;
+
+}
+
+static void append_left (string& out, const string& field, size_t width) {
+
+	out += field;
+	if (field.size() < width) {
+		out.append(width - field.size(), ' ');
+	}
+
+}
+
+/**
+* Format entries the way ls -l does, stat'ing each of them relative to dir
+*/
+static void format_long (int dir, const vector<dir_entry>& entries, bool total, string& out) {
+
+	std::unordered_map<unsigned, string> users, groups;
+	vector<struct stat> stats(entries.size());
+	vector<string> links(entries.size()), owners(entries.size()), group_names(entries.size()), sizes(entries.size());
+	size_t link_width = 0, owner_width = 0, group_width = 0, size_width = 0;
+	unsigned long long blocks = 0;
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+
+		struct stat& st = stats[i];
+
+		if (fstatat(dir, entries[i].name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+			memset(&st, 0, sizeof(st)); // vanished since it was read
+		}
+
+		blocks += st.st_blocks;
+		links[i] = std::to_string(static_cast<unsigned long>(st.st_nlink));
+		owners[i] = user_name(st.st_uid, users);
+		group_names[i] = group_name(st.st_gid, groups);
+
+		if (S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode)) {
+			sizes[i] = std::to_string(major(st.st_rdev)) + ", " + std::to_string(minor(st.st_rdev));
+		} else {
+			sizes[i] = std::to_string(static_cast<long long>(st.st_size));
+		}
+
+		link_width = std::max(link_width, links[i].size());
+		owner_width = std::max(owner_width, owners[i].size());
+		group_width = std::max(group_width, group_names[i].size());
+		size_width = std::max(size_width, sizes[i].size());
+	}
+
+	if (total) {
+		out += "total " + std::to_string((blocks + 1) / 2) + "\n"; // st_blocks counts 512-byte units
+	}
+
+	time_t now = time(nullptr);
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+
+		const struct stat& st = stats[i];
+
+		append_mode(out, st.st_mode);
+		out += ' ';
+		append_right(out, links[i], link_width);
+		out += ' ';
+		append_left(out, owners[i], owner_width);
+		out += ' ';
+		append_left(out, group_names[i], group_width);
+		out += ' ';
+		append_right(out, sizes[i], size_width);
+		out += ' ';
+
+		char date[32];
+		struct tm local;
+		localtime_r(&st.st_mtime, &local);
+		bool recent = st.st_mtime > now - half_year && st.st_mtime <= now;
+		out.append(date, strftime(date, sizeof(date), recent ? "%b %e %H:%M" : "%b %e  %Y", &local));
+
+		out += ' ';
+		out.append(entries[i].name, entries[i].length);
+
+		if (S_ISLNK(st.st_mode)) {
+			char target[PATH_MAX];
+			ssize_t n = readlinkat(dir, entries[i].name, target, sizeof(target));
+			if (n > 0) {
+				out += " -> ";
+				out.append(target, n);
+			}
+		}
+
+		out += '\n';
+	}
+
+}
+
+/**
+* Write a whole buffer, retrying short writes
+*/
+static bool write_all (int fd, const char* buf, size_t n) {
+
+	while (n > 0) {
+		ssize_t written = write(fd, buf, n);
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		buf += written;
+		n -= written;
+	}
+
+	return true;
+
+}
+
+void ls (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	list_options opts;
+	vector<string> paths;
+
+	// the native listing covers what scripts ask for; everything else keeps the real ls
+	if (!run_in_fg || !parse_options(tokens, opts, paths) || paths.size() > 1
+	    || (!opts.one && !opts.long_format && isatty(STDOUT_FILENO))) {
+		run_external(tokens, run_in_fg, false); // redirections are already on the shell's descriptors
+		return;
+	}
+
+	const char* path = paths.empty() ? "." : paths[0].c_str();
+	vector<dir_entry> entries;
+	string out;
+	int dir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	names.clear();
+
+	if (dir == -1) {
+
+		struct stat st;
+
+		if (errno != ENOTDIR || lstat(path, &st) == -1) { // a plain file is listed as itself
+			cerr << "ls: cannot access '" << path << "': " << strerror(errno) << endl;
+			last_status = 2;
+			return;
+		}
+
+		entries.push_back(make_entry(path, strlen(path)));
+
+		if (opts.long_format) {
+			format_long(AT_FDCWD, entries, false, out);
+		} else {
+			out.append(path).append("\n");
+		}
+
+	} else {
+
+		if (!read_entries(dir, opts, entries)) {
+			cerr << "ls: reading directory '" << path << "': " << strerror(errno) << endl;
+			last_status = 2;
+		}
+
+		if (!opts.unsorted) {
+			std::sort(entries.begin(), entries.end(), entry_less);
+		}
+
+		if (opts.long_format) {
+			format_long(dir, entries, true, out);
+		} else {
+			size_t bytes = entries.size();
+			for (vector<dir_entry>::const_iterator iter = entries.cbegin(); iter != entries.cend(); iter++) {
+				bytes += iter -> length;
+			}
+			out.reserve(bytes);
+			for (vector<dir_entry>::const_iterator iter = entries.cbegin(); iter != entries.cend(); iter++) {
+				out.append(iter -> name, iter -> length);
+				out += '\n';
+			}
+		}
+
+		close(dir);
+	}
+
+	cout.flush(); // anything the shell printed before comes first
+
+	if (!write_all(STDOUT_FILENO, out.data(), out.size())) {
+		perror("ls: write error");
+		last_status = 2;
+	}
+
+}
+
+}
@@ -0,0 +1,27 @@
+#ifndef _LS_H_
+#define _LS_H_
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Command that lists a directory inside the shell: ls [-aAU1l] [<path>]
+* Entries are read with large getdents64 calls, their names are copied into an arena
+* and sorted there, and the whole listing is written at once. Files are only stat'ed for -l.
+* Names are printed one per line in byte order, as ls does with LC_ALL=C when not writing to a terminal.
+* Anything else, such as other options, several paths, a background listing
+* or a column listing on a terminal, is handed to the external ls
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void ls (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
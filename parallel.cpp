@@ -0,0 +1,203 @@
+#include "parallel.h"
+#include "cmds.h"
+#include "spawn.h"
+#include "reaper.h"
+#include "input.h"
+#include "lexer.h"
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+/**
+* Ids of the jobs the running parallel builtin is waiting for
+*/
+static std::unordered_set<unsigned long> in_flight;
+
+/**
+* Jobs that failed to launch, exited with a non-zero code or were killed
+*/
+static unsigned failed = 0;
+
+/**
+* Reap listener counting the builtin's own jobs as they finish
+*/
+static void job_done (const process& entry) {
+
+	if (in_flight.erase(entry.id) == 0) {
+		return; // not one of ours
+	}
+
+	if (entry.state > 0 || entry.exit_code != 0) {
+		failed++;
+	}
+
+}
+
+/**
+* Start one job. Its pid is registered before any SIGCHLD for it can be handled
+*/
+static void launch (vector<string>& job) {
+
+	spawn_plan plan;
+	make_plan(job, plan);
+	plan_options(plan, -1, -1); // no cgroup, each job is too short-lived for one
+
+	sigset_t orig_mask;
+	block_sigchld(orig_mask);
+
+	pid_t child = spawn(plan, orig_mask);
+
+	if (child > 0) {
+		process& entry = add_process(child, job, true);
+		record_launch(entry, plan);
+		entry.restart = restart_never;
+		in_flight.insert(entry.id);
+	}
+
+	restore_sigmask(orig_mask);
+
+	if (child == -1) {
+		errno = plan.exec_errno != 0 ? plan.exec_errno : errno;
+		perror(("Exec of " + job[0] + " in parallel failed").c_str());
+		failed++;
+	}
+
+}
+
+/**
+* Read the next line of arguments
+* @return false when there are no more
+*/
+static bool next_arguments (std::ifstream& file, bool from_file, vector<string>& args) {
+
+	static arena scratch;
+	string line;
+
+	while (true) {
+
+		if (from_file ? !getline(file, line) : !read_command(line)) {
+			return false;
+		}
+
+		vector<word> words;
+		scratch.clear();
+
+		if (!lex(line.data(), line.size(), words, scratch)) {
+			cerr << "Unterminated quote in arguments: " << line << endl;
+			failed++;
+			continue;
+		}
+
+		if (words.empty()) {
+			if (from_file) {
+				continue; // skip blank lines in files
+			}
+			return false; // an empty line ends the arguments typed at the shell
+		}
+
+		args.clear();
+		for (vector<word>::const_iterator iter = words.cbegin(); iter != words.cend(); iter++) {
+			args.push_back(iter -> str());
+		}
+
+		return true;
+	}
+
+}
+
+void parallel (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	long max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	const char* arg_file = nullptr;
+	size_t i = 1;
+
+	for (; i < tokens.size(); ++i) { // options
+
+		string value;
+
+		if (tokens[i] == "-a" && i + 1 < tokens.size()) {
+			arg_file = tokens[++i].c_str();
+			continue;
+		} else if (tokens[i] == "-j" && i + 1 < tokens.size()) {
+			value = tokens[++i];
+		} else if (tokens[i].compare(0, 2, "-j") == 0 && tokens[i].size() > 2) {
+			value = tokens[i].substr(2);
+		} else {
+			break; // start of the command
+		}
+
+		char* end = nullptr;
+		max_jobs = strtol(value.c_str(), &end, 10);
+
+		if (*end != '\0' || max_jobs < 1) {
+			max_jobs = 0;
+			break;
+		}
+	}
+
+	// redirections were applied to the shell by run_command, the jobs inherit them
+	vector<string> base(tokens.begin() + i, tokens.end());
+
+	if (max_jobs < 1 || base.empty()) {
+		cerr << "Wrong arguments! \n";
+		cerr << "Correct form: parallel [-j <jobs>] [-a <file>] <command> [<arguments>...]\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
+
+	std::ifstream file;
+
+	if (arg_file != nullptr) {
+		file.open(arg_file);
+		if (!file.is_open()) {
+			perror(arg_file);
+			last_status = EXIT_FAILURE;
+			return;
+		}
+	}
+
+	reap_listener previous = set_reap_listener(job_done);
+	failed = 0;
+
+	unsigned long launched = 0;
+	bool more = true;
+	vector<string> args;
+
+	while (more || !in_flight.empty()) {
+
+		// top up to max_jobs, then sleep until one of them is reaped
+		while (more && in_flight.size() < static_cast<size_t>(max_jobs)) {
+
+			more = next_arguments(file, arg_file != nullptr, args);
+
+			if (more) {
+				vector<string> job = base;
+				job.insert(job.end(), args.begin(), args.end());
+				launch(job);
+				launched++;
+			}
+		}
+
+		if (!in_flight.empty()) {
+			reaper_wait();
+		}
+	}
+
+	set_reap_listener(previous);
+
+	cout << "parallel: " << launched << " jobs, " << failed << " failed" << endl;
+	last_status = failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
+
+}
@@ -0,0 +1,27 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Command that runs a command once per line of arguments, keeping at most N jobs running:
+* parallel [-j N] [-a <file>] <command> [<arguments>...]
+* Each line of the file, or of the shell's input up to an empty line or end of input,
+* is split into words and appended to the command. Jobs are started as others are reaped,
+* so the builtin sleeps while all N are busy. N defaults to the number of online CPUs.
+* The exit status is 0 if every job succeeded, 1 otherwise
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output of every job should be redirected or not
+*/
+void parallel (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
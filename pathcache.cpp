@@ -0,0 +1,162 @@
+#include "pathcache.h"
+#include "cmds.h"
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+/**
+* A resolved command
+*/
+struct cached_path {
+	string path;             // the executable
+	string dir;              // the PATH entry it was found in
+	struct timespec dir_mtime; // modification time of dir when it was found
+	unsigned long hits;
+};
+
+static std::unordered_map<string, cached_path> cache;
+
+/**
+* The PATH the cache was filled with
+*/
+static string cached_path_var;
+
+/**
+* Search every PATH entry for an executable regular file
+* @return false if there is none
+*/
+static bool search_path (const string& name, const string& path_var, cached_path& found) {
+
+	size_t begin = 0;
+
+	while (begin <= path_var.size()) {
+
+		size_t end = path_var.find(':', begin);
+		if (end == string::npos) {
+			end = path_var.size();
+		}
+
+		string dir = end > begin ? path_var.substr(begin, end - begin) : "."; // an empty entry is the working directory
+		string candidate = dir + "/" + name;
+		struct stat st;
+
+		if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(candidate.c_str(), X_OK) == 0) {
+
+			struct stat dir_st;
+
+			if (stat(dir.c_str(), &dir_st) == 0) {
+				found.path = candidate;
+				found.dir = dir;
+				found.dir_mtime = dir_st.st_mtim;
+				found.hits = 0;
+				return true;
+			}
+		}
+
+		begin = end + 1;
+	}
+
+	return false;
+
+}
+
+string resolve_command (const string& name) {
+
+	if (name.find('/') != string::npos) {
+		return name;
+	}
+
+	const char* path_env = getenv("PATH");
+	string path_var = path_env != nullptr ? path_env : "/bin:/usr/bin"; // execvp's default
+
+	if (path_var != cached_path_var) { // PATH changed, every answer may be different
+		cache.clear();
+		cached_path_var = path_var;
+	}
+
+	std::unordered_map<string, cached_path>::iterator hit = cache.find(name);
+
+	if (hit != cache.end()) {
+
+		struct stat dir_st;
+
+		if (stat(hit -> second.dir.c_str(), &dir_st) == 0
+		    && dir_st.st_mtim.tv_sec == hit -> second.dir_mtime.tv_sec
+		    && dir_st.st_mtim.tv_nsec == hit -> second.dir_mtime.tv_nsec) {
+			hit -> second.hits++;
+			return hit -> second.path;
+		}
+
+		cache.erase(hit); // the directory changed, the executable may be gone or replaced
+	}
+
+	cached_path found;
+
+	if (!search_path(name, path_var, found)) {
+		return string();
+	}
+
+	found.hits = 1;
+	cache[name] = found;
+
+	return found.path;
+
+}
+
+void hash_reset () {
+
+	cache.clear();
+
+}
+
+void hash (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	if (tokens.size() == 2 && tokens[1] == "-r") {
+		hash_reset();
+		return;
+	}
+
+	if (tokens.size() == 1) {
+
+		if (cache.empty()) {
+			cout << "hash: hash table empty\n";
+			return;
+		}
+
+		cout << "hits\tcommand\n";
+
+		for (std::unordered_map<string, cached_path>::const_iterator iter = cache.cbegin(); iter != cache.cend(); iter++) {
+			cout << "   " << iter -> second.hits << "\t" << iter -> second.path << endl;
+		}
+
+		return;
+	}
+
+	for (vector<string>::const_iterator name = tokens.cbegin() + 1; name != tokens.cend(); name++) {
+
+		if ((*name)[0] == '-' || name -> find('/') != string::npos) {
+			cerr << "Correct form: hash [-r | <command name>...]\n";
+			last_status = EXIT_FAILURE;
+			return;
+		}
+
+		if (resolve_command(*name).empty()) {
+			cerr << "hash: " << *name << ": not found\n";
+			last_status = EXIT_FAILURE;
+			continue;
+		}
+
+		cache[*name].hits--; // resolving to fill the cache is not a use
+	}
+
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef _PATHCACHE_H_
+#define _PATHCACHE_H_
+
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Resolve a command name to the executable execvp would run, remembering the answer.
+* A cached path is reused as long as PATH is unchanged and the directory holding
+* the executable has not been modified since it was found, so a launch costs one stat
+* instead of a failed execve per PATH entry. Names containing a slash are returned as they are
+* @param name The command name
+* @return The path of the executable, or an empty string if no PATH entry has one
+*/
+string resolve_command (const string& name);
+
+/**
+* Forget every cached path
+*/
+void hash_reset ();
+
+/**
+* Command that shows or manages the cache of command paths:
+* hash lists the cached commands with their hit counts, hash -r empties the cache,
+* and hash <name>... resolves the names and adds them to it
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void hash (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
@@ -0,0 +1,387 @@
+#include "pipeline.h"
+#include "cmds.h"
+#include "spawn.h"
+#include "redirect.h"
+#include "reaper.h"
+#include "builtins.h"
+#include "shmjobs.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <csignal>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+using std::cout;
+using std::cerr;
+
+namespace ss {
+
+/**
+* Largest amount of data moved by one tee or splice call
+*/
+static const size_t splice_chunk = 1 << 20;
+
+vector<size_t> find_pipes (const vector<string>& tokens) {
+
+	vector<size_t> pipes;
+
+	for (size_t i = 0; i < tokens.size(); ++i) {
+		if (tokens[i] == "|") {
+			pipes.push_back(i);
+		}
+	}
+
+	return pipes;
+
+}
+
+bool is_builtin_stage (const vector<string>& args) {
+
+	return args[0] == "tee" && args.size() <= 2 && (args.size() == 1 || args[1][0] != '-');
+
+}
+
+/**
+* Write a whole buffer, retrying short writes
+*/
+static bool write_all (int fd, const char* buf, size_t n) {
+
+	while (n > 0) {
+		ssize_t written = write(fd, buf, n);
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		buf += written;
+		n -= written;
+	}
+
+	return true;
+
+}
+
+/**
+* The fallback of splice_stage for descriptors that are not pipes
+*/
+static int copy_stage (int file) {
+
+	static char buf[64 * 1024];
+	ssize_t n;
+
+	while ((n = read(STDIN_FILENO, buf, sizeof(buf))) != 0) {
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("tee: read");
+			return EXIT_FAILURE;
+		}
+
+		if (!write_all(STDOUT_FILENO, buf, n) || (file != -1 && !write_all(file, buf, n))) {
+			perror("tee: write");
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+
+}
+
+int splice_stage (const char* path) {
+
+	int file = -1;
+
+	if (path != nullptr) {
+		file = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+		if (file == -1) {
+			perror("tee: cannot open file");
+			return EXIT_FAILURE;
+		}
+	}
+
+	while (true) {
+
+		ssize_t n;
+
+		if (file != -1) { // duplicate into stdout, then move the same bytes into the file
+			n = tee(STDIN_FILENO, STDOUT_FILENO, splice_chunk, 0);
+		} else {
+			n = splice(STDIN_FILENO, nullptr, STDOUT_FILENO, nullptr, splice_chunk, SPLICE_F_MOVE);
+		}
+
+		if (n == 0) { // no data and no writers left
+			return EXIT_SUCCESS;
+		}
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EINVAL) { // stdin or stdout is not a pipe
+				return copy_stage(file);
+			}
+			perror("tee: splice");
+			return EXIT_FAILURE;
+		}
+
+		while (file != -1 && n > 0) {
+
+			ssize_t moved = splice(STDIN_FILENO, nullptr, file, nullptr, n, SPLICE_F_MOVE);
+
+			if (moved <= 0) {
+				if (moved == -1 && errno == EINTR) {
+					continue;
+				}
+				perror("tee: splice to file");
+				return EXIT_FAILURE;
+			}
+
+			n -= moved;
+		}
+	}
+
+}
+
+/**
+* Fork the built-in tee stage or a stage running a builtin. They run shell code rather than exec'ing,
+* so they cannot use the vfork path, but they join the job's cgroup, limits, CPUs and capture
+* through the same plan as the other stages
+* @param command The builtin, or nullptr for the tee stage
+* @param next_in_fd The read end of the stage's output pipe, which belongs to the next stage
+*/
+static pid_t fork_stage (vector<string>& args, const builtin* command, spawn_plan& plan, int next_in_fd, const sigset_t& orig_mask) {
+
+	// or the child would write what is still buffered a second time
+	cout.flush();
+	fflush(stdout);
+
+	pid_t p = fork();
+
+	if (p == 0) { // child
+
+		signal(SIGCHLD, SIG_DFL);
+		restore_sigmask(orig_mask);
+
+		if (!setup_child(plan)) {
+			errno = plan.exec_errno;
+			perror((args[0] + " in pipeline").c_str());
+			_exit(127);
+		}
+
+		// without an exec, close-on-exec does not close the originals
+		close_plan(plan);
+
+		if (next_in_fd != -1) {
+			close(next_in_fd);
+		}
+
+		close_captures(); // the read ends of the shell's rings
+
+		if (command == nullptr) {
+			_exit(splice_stage(args.size() > 1 ? args[1].c_str() : nullptr));
+		}
+
+		// the builtin sees the shell's jobs, but its own children are reaped in the stage
+		reaper_initialize();
+		shared_jobs_detach();
+
+		call_builtin(*command, args, true, false);
+
+		cout.flush();
+		fflush(stdout);
+		_exit(last_status);
+
+	}
+
+	if (p > 0) { // also from the parent, so later stages never try to join a group that does not exist yet
+		setpgid(p, plan.pgid == 0 ? p : plan.pgid);
+	}
+
+	return p;
+
+}
+
+/**
+* Hand the terminal to a process group. SIGTTOU is blocked so the shell may do this
+* even while it is not in the foreground group itself
+*/
+static void give_terminal (pid_t pgid) {
+
+	sigset_t ttou_mask, orig_mask;
+	sigemptyset(&ttou_mask);
+	sigaddset(&ttou_mask, SIGTTOU);
+	sigprocmask(SIG_BLOCK, &ttou_mask, &orig_mask);
+
+	tcsetpgrp(STDIN_FILENO, pgid);
+
+	sigprocmask(SIG_SETMASK, &orig_mask, nullptr);
+
+}
+
+void run_pipeline (vector<string>& tokens, const vector<size_t>& pipes, bool run_in_fg) {
+
+	vector<vector<string> > stages;
+	size_t begin = 0;
+
+	for (size_t i = 0; i <= pipes.size(); ++i) {
+
+		size_t end = i < pipes.size() ? pipes[i] : tokens.size();
+
+		if (end <= begin) {
+			cerr << "Missing command in pipeline.\n";
+			last_status = EXIT_FAILURE;
+			return;
+		}
+
+		stages.push_back(vector<string>(tokens.begin() + begin, tokens.begin() + end));
+		begin = end + 1;
+	}
+
+	// no stage can be reaped before the pipeline is pushed onto the vector
+	sigset_t orig_mask;
+	block_sigchld(orig_mask);
+
+	vector<pid_t> pids;
+	pid_t pgid = 0; // the first stage leads the group
+	double first_fork = monotonic_now();
+	int in_fd = -1;
+	bool last_failed = false;
+	int cgroup = open_limits(); // one cgroup for all the stages
+	std::shared_ptr<output_ring> captured;
+	int output = open_output(captured); // and one ring
+
+	for (size_t i = 0; i < stages.size(); ++i) {
+
+		int pipefd[2] = { -1, -1 };
+
+		if (i + 1 < stages.size() && pipe2(pipefd, O_CLOEXEC) == -1) {
+			perror("Error creating pipe in pipeline");
+			last_failed = true; // the later stages never launch
+			break;
+		}
+
+		vector<string> args;
+		vector<redirection> redirs;
+		vector<fd_action> actions;
+		vector<int> opened;
+		pid_t child;
+
+		if (!parse_redirections(stages[i], args, redirs)) {
+			child = -1;
+		} else if (args.empty()) {
+			cerr << "Missing command in pipeline.\n";
+			child = -1;
+		} else if (!open_redirections(redirs, actions, opened)) {
+			child = -1;
+		} else if (args[0] == "wait") {
+			cerr << "wait cannot run in a pipeline: the shell's jobs are not children of the stage.\n";
+			child = -1;
+		} else {
+
+			spawn_plan plan;
+			make_plan(args, plan);
+			plan.in_fd = in_fd;
+			plan.out_fd = pipefd[1];
+			plan.actions = actions;
+			plan.pgid = pgid;
+			plan_options(plan, cgroup, output);
+
+			const builtin* command = is_builtin_stage(args) ? nullptr : find_builtin(args[0]);
+
+			if (command != nullptr || is_builtin_stage(args)) { // never looked up in PATH
+
+				child = fork_stage(args, command, plan, pipefd[0], orig_mask);
+
+				if (child == -1) {
+					perror("Fork in pipeline failed");
+				}
+
+			} else {
+
+				child = spawn(plan, orig_mask);
+
+				if (child == -1) {
+					errno = plan.exec_errno != 0 ? plan.exec_errno : errno;
+					perror(("Exec of " + args[0] + " in pipeline failed").c_str());
+				}
+			}
+		}
+
+		// the stages hold their own copies now
+		close_redirections(opened);
+
+		if (in_fd != -1) {
+			close(in_fd);
+		}
+
+		if (pipefd[1] != -1) {
+			close(pipefd[1]);
+		}
+
+		in_fd = pipefd[0];
+
+		if (child > 0) {
+			pids.push_back(child);
+			if (pgid == 0) {
+				pgid = child;
+			}
+		}
+
+		last_failed = child <= 0;
+	}
+
+	if (in_fd != -1) {
+		close(in_fd);
+	}
+
+	if (cgroup != -1) {
+		close(cgroup);
+	}
+
+	if (output != -1) {
+		close(output);
+	}
+
+	if (pids.empty()) {
+		remove_job_cgroup(options.limits);
+		restore_sigmask(orig_mask);
+		last_status = 127;
+		return;
+	}
+
+	process& entry = add_process(pids[0], tokens, run_in_fg, pids);
+	entry.output = captured;
+
+	if (last_failed) { // the status of a stage that never ran, not of the one before it
+		entry.last_failed = true;
+		entry.state = 0;
+		entry.exit_code = 127;
+	}
+
+	entry.launched = first_fork;
+	entry.exec_latency = monotonic_now() - first_fork; // until the last stage exec'd
+	restore_sigmask(orig_mask);
+
+	if (run_in_fg) { // fg: wait immediately, with the terminal handed to the pipeline
+
+		bool interactive = isatty(STDIN_FILENO);
+
+		if (interactive) {
+			give_terminal(pgid);
+		}
+
+		wait_fg(pids[0]);
+
+		if (interactive) {
+			give_terminal(getpgrp());
+		}
+	}
+
+}
+
+}
@@ -0,0 +1,50 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Run the stages of a pipeline connected by pipes. All stages join the process group
+* of the first one and the pipeline is tracked as a single job in ps, keyed by its first stage.
+* A foreground pipeline is given the terminal while it runs.
+* Stages named tee with at most one file argument run as the built-in splice stage,
+* and builtins run in a forked child of the shell. wait is refused, having no jobs to wait for there
+* @param tokens The whole command, stages separated by "|" tokens
+* @param pipes Indices of the "|" tokens separating the stages
+* @param run_in_fg Specifier of whether the pipeline runs in the foreground or not
+*/
+void run_pipeline (vector<string>& tokens, const vector<size_t>& pipes, bool run_in_fg);
+
+/**
+* Find the "|" tokens of a command. Used when a recorded pipeline is rerun,
+* since quoting is no longer known at that point
+* @param tokens The command
+* @return Indices of the "|" tokens
+*/
+vector<size_t> find_pipes (const vector<string>& tokens);
+
+/**
+* Check whether a stage runs as the built-in splice stage: tee [file]
+* @param args The stage's command name and arguments
+*/
+bool is_builtin_stage (const vector<string>& args);
+
+/**
+* The built-in stage: copy stdin to stdout, and to a file if given, inside the kernel.
+* When stdin and stdout are pipes, data is duplicated with tee() and moved with splice()
+* without passing through user space; other descriptors fall back to read/write
+* @param path File receiving a copy of the data, or nullptr
+* @return The exit status of the stage
+*/
+int splice_stage (const char* path);
+
+}
+
+#endif
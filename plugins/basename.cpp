@@ -0,0 +1,53 @@
+/**
+* Example plugin: basename as an in-process builtin.
+* Build with make plugins, then load it with
+*   enable -f plugins/basename.so basename
+*/
+#include "ss_plugin.h"
+#include <cstdio>
+#include <cstring>
+
+/**
+* Print the last component of a path, without a trailing suffix if one is given
+*/
+static int run (int argc, char* argv[]) {
+
+	if (argc < 2 || argc > 3) {
+		fputs("Correct form: basename <path> [<suffix>]\n", stderr);
+		return 1;
+	}
+
+	const char* path = argv[1];
+	size_t end = strlen(path);
+
+	while (end > 1 && path[end - 1] == '/') { // trailing slashes are not part of the name
+		end--;
+	}
+
+	size_t begin = end;
+
+	while (begin > 0 && path[begin - 1] != '/') {
+		begin--;
+	}
+
+	if (begin == end && end > 0) { // the path is only slashes
+		begin = end - 1;
+	}
+
+	size_t length = end - begin;
+
+	if (argc == 3) {
+		size_t suffix = strlen(argv[2]);
+		if (suffix < length && memcmp(path + end - suffix, argv[2], suffix) == 0) {
+			length -= suffix;
+		}
+	}
+
+	fwrite(path + begin, 1, length, stdout);
+	fputc('\n', stdout);
+
+	return 0;
+
+}
+
+extern "C" const ss_plugin basename_builtin = { SS_PLUGIN_ABI, "basename", "basename <path> [<suffix>]", run };
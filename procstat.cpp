@@ -0,0 +1,89 @@
+#include "procstat.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace ss {
+
+bool parse_proc_stat (const char* buf, size_t length, proc_stat& st) {
+
+	// the name is in parentheses and may itself contain spaces and parentheses
+	const char* open_paren = static_cast<const char*>(memchr(buf, '(', length));
+	const char* close_paren = nullptr;
+
+	for (const char* p = buf + length; p > buf; --p) {
+		if (p[-1] == ')') {
+			close_paren = p - 1;
+			break;
+		}
+	}
+
+	if (open_paren == nullptr || close_paren == nullptr || close_paren < open_paren || close_paren + 3 >= buf + length) {
+		return false;
+	}
+
+	size_t comm_length = close_paren - open_paren - 1;
+	if (comm_length >= sizeof(st.comm)) {
+		comm_length = sizeof(st.comm) - 1;
+	}
+	memcpy(st.comm, open_paren + 1, comm_length);
+	st.comm[comm_length] = '\0';
+
+	st.state = close_paren[2];
+
+	// fields 4 onwards are numbers; the buffer ends with a newline, which stops strtoull
+	const char* p = close_paren + 3;
+	char* end;
+	unsigned long long field[25];
+
+	for (int i = 4; i <= 24; ++i) {
+		field[i] = strtoull(p, &end, 10);
+		if (end == p) {
+			return false;
+		}
+		p = end;
+	}
+
+	st.utime = field[14];
+	st.stime = field[15];
+	st.num_threads = field[20];
+	st.starttime = field[22];
+	st.rss = field[24];
+
+	return true;
+
+}
+
+bool read_proc_stat (pid_t pid, proc_stat& st) {
+
+	char path[32];
+	snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		return false;
+	}
+
+	char buf[1024];
+	ssize_t n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+
+	if (n <= 0) {
+		return false;
+	}
+
+	buf[n] = '\0';
+	return parse_proc_stat(buf, n, st);
+
+}
+
+double seconds_per_tick () {
+
+	static double tick = 1.0 / sysconf(_SC_CLK_TCK);
+	return tick;
+
+}
+
+}
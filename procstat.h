@@ -0,0 +1,46 @@
+#ifndef _PROCSTAT_H_
+#define _PROCSTAT_H_
+
+#include <sys/types.h>
+#include <cstddef>
+
+namespace ss {
+
+/**
+* The fields of /proc/<pid>/stat the shell reports on
+*/
+struct proc_stat {
+	char comm[64];                // executable name, truncated
+	char state;                   // R, S, D, Z, T, ...
+	unsigned long utime;          // user CPU time in clock ticks
+	unsigned long stime;          // system CPU time in clock ticks
+	long num_threads;
+	unsigned long long starttime; // clock ticks after boot
+	long rss;                     // resident set size in pages
+};
+
+/**
+* Parse the contents of a /proc/<pid>/stat file
+* @param buf The file contents, null-terminated
+* @param length Number of bytes in buf, not counting the terminator
+* @param st Receives the fields
+* @return false if the contents are malformed
+*/
+bool parse_proc_stat (const char* buf, size_t length, proc_stat& st);
+
+/**
+* Read and parse /proc/<pid>/stat
+* @param pid The process to look at
+* @param st Receives the fields
+* @return false if the process does not exist or the file is malformed
+*/
+bool read_proc_stat (pid_t pid, proc_stat& st);
+
+/**
+* @return Seconds per clock tick as used by /proc
+*/
+double seconds_per_tick ();
+
+}
+
+#endif
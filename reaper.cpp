@@ -0,0 +1,343 @@
+#include "reaper.h"
+#include "cmds.h"
+#include "stats.h"
+#include "redirect.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <csignal>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+
+using std::cout;
+using std::endl;
+
+namespace ss {
+
+/**
+* A restart scheduled by the supervisor
+*/
+struct pending_restart {
+	vector<string> tokens;
+	restart_policy restart;
+	supervision history;
+	job_limits limits;
+	bool pinned;
+	cpu_set_t cpus;
+	size_t capture;
+	string spill;
+};
+
+static int self_pipe[2] = { -1, -1 };
+
+/**
+* The epoll set the main loop sleeps on: the self-pipe and the watched descriptors
+*/
+static int wait_fd = -1;
+
+static std::unordered_map<int, fd_handler> handlers;
+
+/**
+* Set by ch_handler, so that reaper_dispatch can return without a system call when nothing happened
+*/
+static volatile sig_atomic_t notified = 0;
+
+static reap_listener listener = nullptr;
+
+/**
+* Restarts waiting for their backoff to expire, keyed by the monotonic time they are due
+*/
+static std::multimap<double, pending_restart> restarts;
+
+double monotonic_now () {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+void reaper_initialize () {
+
+	if (self_pipe[0] != -1) { // shared with the parent shell
+		close(self_pipe[0]);
+		close(self_pipe[1]);
+		close(wait_fd);
+		restarts.clear();
+		handlers.clear();
+		listener = nullptr;
+		notified = 0;
+	}
+
+	if (pipe2(self_pipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+		perror("Error creating the SIGCHLD self-pipe");
+		exit(EXIT_FAILURE);
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.fd = self_pipe[0];
+
+	if ((wait_fd = epoll_create1(EPOLL_CLOEXEC)) == -1 || epoll_ctl(wait_fd, EPOLL_CTL_ADD, self_pipe[0], &event) == -1) {
+		perror("Error creating the epoll set");
+		exit(EXIT_FAILURE);
+	}
+
+	struct sigaction sa;
+	sa.sa_handler = ch_handler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigaction(SIGCHLD, &sa, nullptr);
+
+}
+
+void ch_handler (int signum) { // notify the main loop when SIGCHLD arrives
+
+	int saved_errno = errno;
+
+	notified = 1;
+
+	char notification = 0;
+	if (write(self_pipe[1], &notification, 1) == -1) {
+		// the pipe is full, so the main loop has a notification pending already
+	}
+
+	errno = saved_errno;
+
+}
+
+int reaper_fd () {
+
+	return wait_fd;
+
+}
+
+bool watch_fd (int fd, fd_handler handler) {
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+
+	if (epoll_ctl(wait_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+		return false;
+	}
+
+	handlers[fd] = handler;
+	return true;
+
+}
+
+void unwatch_fd (int fd) {
+
+	if (handlers.erase(fd) > 0) {
+		epoll_ctl(wait_fd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+
+}
+
+/**
+* Call the handlers of the watched descriptors that are ready
+*/
+static void serve_watched () {
+
+	struct epoll_event events[64];
+	int ready = epoll_wait(wait_fd, events, 64, 0);
+
+	for (int i = 0; i < ready; ++i) {
+
+		// an earlier handler may have unwatched it
+		std::unordered_map<int, fd_handler>::const_iterator handler = handlers.find(events[i].data.fd);
+
+		if (handler != handlers.end()) {
+			handler -> second(events[i].data.fd);
+		}
+	}
+
+}
+
+bool restarts_pending () {
+
+	return !restarts.empty();
+
+}
+
+int reaper_timeout () {
+
+	if (restarts.empty()) {
+		return -1;
+	}
+
+	double delay = restarts.begin() -> first - monotonic_now();
+	return delay <= 0 ? 0 : static_cast<int>(delay * 1000) + 1;
+
+}
+
+/**
+* Decide whether a terminated background job should be restarted
+*/
+static bool wants_restart (const process& entry) {
+
+	switch (entry.restart) {
+		case restart_never:
+			return false;
+		case restart_on_signal:
+			return entry.state > 0 && entry.state != SIGSEGV && entry.state != SIGKILL;
+		case restart_on_failure:
+			return entry.state > 0 || entry.exit_code != 0;
+		case restart_always:
+			return true;
+	}
+
+	return false;
+
+}
+
+/**
+* Schedule a restart with exponential backoff, or give up if the job
+* restarted too often within the current window
+*/
+static void supervise (const process& entry) {
+
+	double now = monotonic_now();
+	supervision history = entry.history;
+
+	if (history.restarts == 0 || now - history.window_start > restart_window) { // start a new window
+		history.restarts = 0;
+		history.window_start = now;
+		history.backoff_ms = initial_backoff_ms;
+	}
+
+	if (history.restarts >= max_restarts) {
+		cout << "Child " << entry.pid << " restarted " << history.restarts << " times in "
+		     << restart_window << " seconds, giving up." << endl;
+		return;
+	}
+
+	cout << "About to restart child " << entry.pid << " in " << history.backoff_ms << " ms" << endl;
+
+	pending_restart next;
+	next.tokens = entry.tokens;
+	next.restart = entry.restart;
+	next.history = history;
+	next.limits = entry.limits;
+	next.pinned = entry.pinned; // a restart stays where it was placed
+	next.cpus = entry.cpus;
+	next.capture = entry.output ? entry.output -> data.size() : 0; // a fresh ring for the new run
+	next.spill = entry.output ? entry.output -> spill_path : string();
+	next.history.restarts++;
+	next.history.backoff_ms = std::min(history.backoff_ms * 2, max_backoff_ms);
+
+	restarts.insert(std::make_pair(now + history.backoff_ms / 1000.0, next));
+
+}
+
+/**
+* Launch the restarts whose backoff has expired, in the background
+*/
+static void run_due_restarts () {
+
+	double now = monotonic_now();
+
+	while (!restarts.empty() && restarts.begin() -> first <= now) {
+
+		pending_restart next = restarts.begin() -> second;
+		restarts.erase(restarts.begin());
+
+		bool redir = std::find_if(next.tokens.begin(), next.tokens.end(), is_redirection) != next.tokens.end();
+
+		// a restart can fire in the middle of a command, whose options must survive it
+		job_options saved = options;
+		reset_options();
+
+		options.restart = next.restart;
+		options.history = next.history;
+		options.limits = next.limits;
+		options.pinned = next.pinned;
+		options.cpus = next.cpus;
+		options.capture = next.capture;
+		options.spill = next.spill;
+		recover(next.tokens, false, redir);
+
+		options = saved;
+	}
+
+}
+
+void reaper_dispatch () {
+
+	if (!handlers.empty()) {
+		serve_watched();
+	}
+
+	if (!notified && reaper_timeout() != 0) {
+		return; // no child terminated and no restart is due
+	}
+
+	notified = 0;
+
+	char drain[64];
+	while (read(self_pipe[0], drain, sizeof(drain)) > 0) {
+		// consume all pending notifications
+	}
+
+	pid_t child;
+	int status;
+	struct rusage usage;
+
+	while ((child = wait4(-1, &status, WNOHANG, &usage)) > 0) { // reap terminated child's status and resource usage
+
+		process* entry = ps.mark_reaped(child, status, &usage);
+
+		if (entry != nullptr && entry -> reaped) {
+
+			entry -> finished = monotonic_now();
+			record_job(*entry);
+			remove_job_cgroup(entry -> limits);
+			job_finished(*entry);
+
+			if (listener != nullptr) {
+				listener(*entry);
+			}
+		}
+
+		if (entry != nullptr && entry -> reaped && !entry -> run_in_fg && wants_restart(*entry)) { // only restart background processes
+			supervise(*entry);
+		}
+	}
+
+	ps.trim();
+	run_due_restarts();
+
+}
+
+reap_listener set_reap_listener (reap_listener new_listener) {
+
+	reap_listener previous = listener;
+	listener = new_listener;
+	return previous;
+
+}
+
+void reaper_wait () {
+
+	struct pollfd pfd;
+	pfd.fd = wait_fd; // the self-pipe and the watched descriptors
+	pfd.events = POLLIN;
+
+	if (poll(&pfd, 1, reaper_timeout()) == -1 && errno != EINTR) {
+		perror("Error waiting for children");
+	}
+
+	reaper_dispatch();
+
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef _REAPER_H_
+#define _REAPER_H_
+
+#include <sys/types.h>
+
+namespace ss {
+
+struct process;
+
+/**
+* Function called for every job reaped by reaper_dispatch, before ps is trimmed
+*/
+typedef void (*reap_listener) (const process&);
+
+/**
+* Function called by reaper_dispatch when a watched descriptor is readable or hung up
+*/
+typedef void (*fd_handler) (int fd);
+
+/**
+* Restarts allowed per job within one supervision window before the supervisor gives up
+*/
+const unsigned max_restarts = 5;
+
+/**
+* Length of a supervision window in seconds
+*/
+const double restart_window = 60.0;
+
+/**
+* Delay before the first restart in a window; doubled for every further restart
+*/
+const unsigned initial_backoff_ms = 100;
+
+/**
+* Upper bound of the restart delay
+*/
+const unsigned max_backoff_ms = 30000;
+
+/**
+* Install the SIGCHLD handler and the self-pipe it writes to, and the epoll set the main loop sleeps on.
+* A forked subshell calls it again to get a self-pipe and an epoll set of its own,
+* and to drop the parent's pending restarts, watched descriptors and reap listener
+*/
+void reaper_initialize ();
+
+/**
+* Signal handler that captures the arrival of SIGCHLD.
+* It only writes a byte to the self-pipe; reaping happens in reaper_dispatch
+* @param signum The signal number that arrived
+*/
+void ch_handler (int signum);
+
+/**
+* @return The epoll set holding the self-pipe and the watched descriptors,
+* readable whenever children may need reaping or a watched descriptor is ready
+*/
+int reaper_fd ();
+
+/**
+* Have reaper_dispatch call a handler whenever a descriptor is readable, so that it is served
+* by every loop that waits on reaper_fd. The handler must drain the descriptor or unwatch it
+* @param fd A non-blocking descriptor
+* @param handler The function to call
+* @return false if the descriptor could not be added to the epoll set
+*/
+bool watch_fd (int fd, fd_handler handler);
+
+/**
+* Stop watching a descriptor, before it is closed
+*/
+void unwatch_fd (int fd);
+
+/**
+* @return Whether a job that terminated is waiting out its backoff before being restarted
+*/
+bool restarts_pending ();
+
+/**
+* @return Milliseconds until the next scheduled restart, 0 if one is due, or -1 if none is pending
+*/
+int reaper_timeout ();
+
+/**
+* Serve the watched descriptors that are ready, then reap every terminated child, update ps with its status
+* and resource usage, schedule restarts according to each job's policy and launch the restarts that are due. Called from the main loop whenever reaper_fd is readable
+* or reaper_timeout expires
+*/
+void reaper_dispatch ();
+
+/**
+* Install the function called for every reaped job
+* @param listener The new listener, or nullptr for none
+* @return The previous listener, to be restored by the caller
+*/
+reap_listener set_reap_listener (reap_listener listener);
+
+/**
+* Sleep until reaper_fd is readable or the next restart is due, then dispatch
+*/
+void reaper_wait ();
+
+/**
+* @return The current CLOCK_MONOTONIC time in seconds
+*/
+double monotonic_now ();
+
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "redirect.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+using std::cout;
+using std::cerr;
+
+namespace ss {
+
+/**
+* Descriptors above this are free for saving the shell's own
+*/
+static const int saved_fd_base = 10;
+
+/**
+* Mode of files created by > and >>, before the umask
+*/
+static const mode_t create_mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
+
+/**
+* Fill in a redirection from its operator
+* @return false if token is not an operator
+*/
+static bool classify (const string& token, redirection& redir) {
+
+	redir.source_fd = -1;
+	redir.here_string = false;
+	redir.flags = 0;
+
+	if (token == "<") {
+		redir.fd = STDIN_FILENO;
+		redir.flags = O_RDONLY;
+	} else if (token == ">" || token == "2>") {
+		redir.fd = token == ">" ? STDOUT_FILENO : STDERR_FILENO;
+		redir.flags = O_WRONLY | O_CREAT | O_TRUNC;
+	} else if (token == ">>" || token == "2>>") {
+		redir.fd = token == ">>" ? STDOUT_FILENO : STDERR_FILENO;
+		redir.flags = O_WRONLY | O_CREAT | O_APPEND;
+	} else if (token == "2>&1") {
+		redir.fd = STDERR_FILENO;
+		redir.source_fd = STDOUT_FILENO;
+	} else if (token == ">&2") {
+		redir.fd = STDOUT_FILENO;
+		redir.source_fd = STDERR_FILENO;
+	} else if (token == "<<<") {
+		redir.fd = STDIN_FILENO;
+		redir.here_string = true;
+	} else {
+		return false;
+	}
+
+	return true;
+
+}
+
+bool is_redirection (const string& token) {
+
+	redirection redir;
+	return classify(token, redir);
+
+}
+
+bool parse_redirections (const vector<string>& tokens, vector<string>& args, vector<redirection>& redirs) {
+
+	args.clear();
+	redirs.clear();
+
+	for (size_t i = 0; i < tokens.size(); ++i) {
+
+		redirection redir;
+
+		if (!classify(tokens[i], redir)) {
+			args.push_back(tokens[i]);
+			continue;
+		}
+
+		if (redir.source_fd == -1) {
+
+			if (i + 1 == tokens.size() || is_redirection(tokens[i + 1])) { // ensure that a target follows the operator
+				cerr << "Cannot redirect. No target specified after " << tokens[i] << ".\n";
+				return false;
+			}
+
+			redir.target = tokens[++i];
+		}
+
+		redirs.push_back(redir);
+	}
+
+	return true;
+
+}
+
+/**
+* Create an anonymous in-memory file holding a here-string and a trailing newline,
+* positioned at its start
+*/
+static int open_here_string (const string& text) {
+
+	int fd = memfd_create("here-string", MFD_CLOEXEC);
+
+	if (fd == -1) {
+		return -1;
+	}
+
+	string content = text + "\n";
+	const char* buf = content.data();
+	size_t n = content.size();
+
+	while (n > 0) {
+		ssize_t written = write(fd, buf, n);
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			int saved_errno = errno;
+			close(fd);
+			errno = saved_errno;
+			return -1;
+		}
+		buf += written;
+		n -= written;
+	}
+
+	lseek(fd, 0, SEEK_SET);
+
+	return fd;
+
+}
+
+bool open_redirections (const vector<redirection>& redirs, vector<fd_action>& actions, vector<int>& opened) {
+
+	for (vector<redirection>::const_iterator iter = redirs.cbegin(); iter != redirs.cend(); iter++) {
+
+		fd_action action;
+		action.fd = iter -> fd;
+
+		if (iter -> source_fd != -1) {
+			action.source = iter -> source_fd;
+			actions.push_back(action);
+			continue;
+		}
+
+		if (iter -> here_string) {
+			action.source = open_here_string(iter -> target);
+		} else {
+			action.source = open(iter -> target.c_str(), iter -> flags | O_CLOEXEC, create_mode);
+		}
+
+		if (action.source == -1) {
+			perror((iter -> here_string ? string("Cannot create here-string") : "Cannot redirect to " + iter -> target).c_str());
+			close_redirections(opened);
+			return false;
+		}
+
+		opened.push_back(action.source);
+		actions.push_back(action);
+	}
+
+	return true;
+
+}
+
+void close_redirections (vector<int>& opened) {
+
+	for (vector<int>::const_iterator iter = opened.cbegin(); iter != opened.cend(); iter++) {
+		close(*iter);
+	}
+
+	opened.clear();
+
+}
+
+bool redirect_shell (const vector<redirection>& redirs, vector<int>& saved) {
+
+	vector<fd_action> actions;
+	vector<int> opened;
+
+	saved.clear();
+
+	if (!open_redirections(redirs, actions, opened)) {
+		return false;
+	}
+
+	cout.flush(); // output so far belongs to the old descriptors
+	cerr.flush();
+
+	for (vector<fd_action>::const_iterator iter = actions.cbegin(); iter != actions.cend(); iter++) {
+
+		bool known = false;
+
+		for (size_t i = 0; i < saved.size(); i += 2) {
+			known = known || saved[i] == iter -> fd;
+		}
+
+		if (!known) { // keep the first version of every descriptor, -1 if it was closed
+			saved.push_back(iter -> fd);
+			saved.push_back(fcntl(iter -> fd, F_DUPFD_CLOEXEC, saved_fd_base));
+		}
+
+		dup2(iter -> source, iter -> fd);
+	}
+
+	close_redirections(opened);
+
+	return true;
+
+}
+
+void restore_shell (vector<int>& saved) {
+
+	cout.flush();
+	cerr.flush();
+
+	for (size_t i = 0; i < saved.size(); i += 2) {
+
+		if (saved[i + 1] != -1) {
+			dup2(saved[i + 1], saved[i]);
+			close(saved[i + 1]);
+		} else {
+			close(saved[i]);
+		}
+	}
+
+	saved.clear();
+
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef _REDIRECT_H_
+#define _REDIRECT_H_
+
+#include <string>
+#include <vector>
+
+#include "spawn.h"
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* One redirection of a command, in the order it was written
+*/
+struct redirection {
+	int fd;           // descriptor being redirected
+	int flags;        // open flags of target, unused for duplications and here-strings
+	int source_fd;    // descriptor copied by n>&m, otherwise -1
+	bool here_string; // target is the text fed to stdin by <<<
+	string target;    // file name or here-string text
+};
+
+/**
+* Check whether a token is a redirection operator:
+* <, >, >>, 2>, 2>>, 2>&1, >&2 or <<<
+*/
+bool is_redirection (const string& token);
+
+/**
+* Separate a command from its redirections. Every operator except the duplications
+* takes the next token as its target
+* @param tokens The command name, its arguments and its redirections
+* @param args Receives the command name and its arguments
+* @param redirs Receives the redirections
+* @return false, with a message printed, if an operator has no target
+*/
+bool parse_redirections (const vector<string>& tokens, vector<string>& args, vector<redirection>& redirs);
+
+/**
+* Open the files and here-strings of a command in the shell, before anything is forked.
+* Descriptors are close-on-exec, so a child keeps only the copies the actions make
+* on its standard descriptors, and a file that cannot be opened costs no fork at all
+* @param redirs The redirections, in order
+* @param actions Receives the dup2 calls that set the redirections up
+* @param opened Receives the descriptors to close once the command has been started
+* @return false, with a message printed and nothing left open, if a file cannot be opened
+*/
+bool open_redirections (const vector<redirection>& redirs, vector<fd_action>& actions, vector<int>& opened);
+
+/**
+* Close the descriptors opened by open_redirections
+*/
+void close_redirections (vector<int>& opened);
+
+/**
+* Apply redirections to the shell itself, for a builtin.
+* The descriptors they replace are saved so restore_shell can put them back
+* @param redirs The redirections, in order
+* @param saved Receives the saved descriptors, in pairs of original and copy
+* @return false, with a message printed and nothing changed, if a file cannot be opened
+*/
+bool redirect_shell (const vector<redirection>& redirs, vector<int>& saved);
+
+/**
+* Undo redirect_shell
+* @param saved The descriptors saved by redirect_shell
+*/
+void restore_shell (vector<int>& saved);
+
+}
+
+#endif
@@ -0,0 +1,1441 @@
+#include "script.h"
+#include "lexer.h"
+#include "arena.h"
+#include "subst.h"
+#include "cmds.h"
+#include "reaper.h"
+#include "redirect.h"
+#include "builtins.h"
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+static command_runner runner = nullptr;
+
+void set_command_runner (command_runner command) {
+
+	runner = command;
+
+}
+
+/**
+* The values of the shell variables, by slot. Programs refer to variables by slot,
+* so a name is only looked up when a program is compiled
+*/
+static vector<string> variables;
+
+static std::unordered_map<string, uint32_t> slots;
+
+/**
+* Find the slot of a variable, creating it from the environment if needed
+*/
+static uint32_t variable_slot (const string& name) {
+
+	std::unordered_map<string, uint32_t>::const_iterator found = slots.find(name);
+
+	if (found != slots.end()) {
+		return found -> second;
+	}
+
+	const char* inherited = getenv(name.c_str());
+	variables.push_back(inherited != nullptr ? inherited : "");
+
+	return slots[name] = variables.size() - 1;
+
+}
+
+/**
+* Whether a string is a variable name
+*/
+static bool is_name (const char* text, size_t length) {
+
+	if (length == 0 || !is_name_start(text[0])) {
+		return false;
+	}
+
+	for (size_t i = 1; i < length; ++i) {
+		if (!is_name_char(text[i])) {
+			return false;
+		}
+	}
+
+	return true;
+
+}
+
+/**
+* Words that open or close a construct when they start a command
+*/
+static const char* const reserved[] = { "do", "done", "elif", "else", "fi", "for", "if", "then", "until", "while", nullptr };
+
+/**
+* Where the lists inside each construct end; the last word is the one that closes it
+*/
+static const char* const if_condition[] = { "then", nullptr };
+static const char* const if_body[] = { "elif", "else", "fi", nullptr };
+static const char* const else_body[] = { "fi", nullptr };
+static const char* const loop_condition[] = { "do", nullptr };
+static const char* const loop_body[] = { "done", nullptr };
+static const char* const top_level[] = { nullptr };
+
+/**
+* Recursive descent over the words of the input, appending to a program
+*/
+class compiler {
+
+public:
+	compiler (const vector<word>& words, program& out, string& error)
+		: words(words), pos(0), out(out), error(error), result(compiled), loops(0) {
+	}
+
+	compile_result run () {
+
+		uint32_t root;
+
+		if (!parse_list(top_level, root) || result != compiled) { // words report their errors through result
+			return result;
+		}
+
+		out.root = root;
+		return compiled;
+
+	}
+
+private:
+	const vector<word>& words;
+	size_t pos;
+	program& out;
+	string& error;
+	compile_result result;
+	unsigned loops; // loops enclosing the current command, for break and continue
+	std::unordered_map<string, uint32_t> interned;
+
+	bool at_end () const {
+
+		return pos == words.size();
+
+	}
+
+	bool at_separator () const {
+
+		return pos < words.size() && (words[pos].is(";") || words[pos].is("\n"));
+
+	}
+
+	bool at (const char* const* names) const {
+
+		for (; *names != nullptr; ++names) {
+			if (pos < words.size() && words[pos].is(*names)) {
+				return true;
+			}
+		}
+
+		return false;
+
+	}
+
+	bool fail (compile_result why, const string& message) {
+
+		result = why;
+		error = message;
+		return false;
+
+	}
+
+	bool unexpected () {
+
+		return fail(malformed, "Syntax error near " + (words[pos].is("\n") ? string("newline") : words[pos].str()) + ".");
+
+	}
+
+	uint32_t intern (const string& text) {
+
+		std::unordered_map<string, uint32_t>::const_iterator found = interned.find(text);
+
+		if (found != interned.end()) {
+			return found -> second;
+		}
+
+		out.strings.push_back(text);
+		return interned[text] = out.strings.size() - 1;
+
+	}
+
+	uint32_t add (node::kind_t kind, uint32_t a = no_index, uint32_t b = no_index, uint32_t c = no_index, uint32_t d = 0) {
+
+		node fresh;
+		fresh.kind = kind;
+		fresh.continues = false;
+		fresh.a = a;
+		fresh.b = b;
+		fresh.c = c;
+		fresh.d = d;
+
+		out.nodes.push_back(fresh);
+		return out.nodes.size() - 1;
+
+	}
+
+	/**
+	* Parse commands up to one of the stop words, or to the end of the input at the top level
+	*/
+	bool parse_list (const char* const* stops, uint32_t& index) {
+
+		vector<uint32_t> items;
+
+		while (true) {
+
+			while (at_separator()) {
+				++pos;
+			}
+
+			if (at_end()) {
+				if (*stops != nullptr) {
+					const char* const* closing = stops;
+					while (closing[1] != nullptr) {
+						++closing;
+					}
+					return fail(incomplete, string("Missing ") + *closing + ".");
+				}
+				break;
+			}
+
+			if (at(stops)) {
+				if (items.empty()) {
+					return unexpected(); // constructs need at least one command
+				}
+				break;
+			}
+
+			uint32_t item;
+
+			if (!parse_command(item)) {
+				return false;
+			}
+
+			items.push_back(item);
+
+			if (!at_end() && !at_separator()) { // like fi followed by a word
+				return unexpected();
+			}
+		}
+
+		if (items.size() == 1) {
+			index = items[0];
+			return true;
+		}
+
+		index = add(node::list, out.children.size(), items.size());
+		out.children.insert(out.children.end(), items.begin(), items.end());
+		return true;
+
+	}
+
+	/**
+	* Expect the word that continues a construct, after parse_list stopped at it
+	*/
+	bool expect (const char* name) {
+
+		if (!words[pos].is(name)) {
+			return unexpected();
+		}
+
+		++pos;
+		return true;
+
+	}
+
+	bool parse_command (uint32_t& index) {
+
+		if (words[pos].is("if")) {
+			++pos;
+			return parse_if(index);
+		}
+
+		if (words[pos].is("while") || words[pos].is("until")) {
+			return parse_loop(index);
+		}
+
+		if (words[pos].is("for")) {
+			return parse_for(index);
+		}
+
+		if (at(reserved)) {
+			return unexpected();
+		}
+
+		return parse_simple(index);
+
+	}
+
+	/**
+	* The rest of an if or elif clause, after its keyword
+	*/
+	bool parse_if (uint32_t& index) {
+
+		uint32_t condition, body, otherwise = no_index;
+
+		if (!parse_list(if_condition, condition) || !expect("then") || !parse_list(if_body, body)) {
+			return false;
+		}
+
+		if (words[pos].is("elif")) { // shares the fi of the whole clause
+			++pos;
+			if (!parse_if(otherwise)) {
+				return false;
+			}
+		} else if (words[pos].is("else")) {
+			++pos;
+			if (!parse_list(else_body, otherwise) || !expect("fi")) {
+				return false;
+			}
+		} else if (!expect("fi")) {
+			return false;
+		}
+
+		index = add(node::if_clause, condition, body, otherwise);
+		return true;
+
+	}
+
+	bool parse_loop (uint32_t& index) {
+
+		node::kind_t kind = words[pos++].is("while") ? node::while_clause : node::until_clause;
+		uint32_t condition, body;
+
+		++loops;
+		bool parsed = parse_list(loop_condition, condition) && expect("do") && parse_list(loop_body, body) && expect("done");
+		--loops;
+
+		if (!parsed) {
+			return false;
+		}
+
+		index = add(kind, condition, body);
+		return true;
+
+	}
+
+	bool parse_for (uint32_t& index) {
+
+		++pos;
+
+		if (at_end()) {
+			return fail(incomplete, "Missing done.");
+		}
+
+		if (words[pos].quoted || !is_name(words[pos].text, words[pos].length)) {
+			return fail(malformed, "Bad for variable " + words[pos].str() + ".");
+		}
+
+		uint32_t slot = variable_slot(words[pos++].str());
+
+		if (at_end()) {
+			return fail(incomplete, "Missing done.");
+		}
+
+		if (!words[pos].is("in")) {
+			return unexpected();
+		}
+
+		++pos;
+
+		uint32_t first = out.words.size();
+
+		for (; !at_end() && !at_separator(); ++pos) { // compiled in a row, so they stay contiguous
+			compile_word(words[pos]);
+		}
+
+		uint32_t count = out.words.size() - first;
+
+		while (at_separator()) {
+			++pos;
+		}
+
+		if (at_end()) {
+			return fail(incomplete, "Missing done.");
+		}
+
+		uint32_t body;
+
+		++loops;
+		bool parsed = expect("do") && parse_list(loop_body, body) && expect("done");
+		--loops;
+
+		if (!parsed) {
+			return false;
+		}
+
+		index = add(node::for_clause, slot, body, first, count);
+		return true;
+
+	}
+
+	/**
+	* A command, a run of assignments, or break, continue and exit
+	*/
+	bool parse_simple (uint32_t& index) {
+
+		size_t begin = pos;
+
+		while (!at_end() && !at_separator()) {
+			++pos;
+		}
+
+		const word& first = words[begin];
+		size_t count = pos - begin;
+
+		if (first.is("break") || first.is("continue")) {
+
+			long levels = 1;
+
+			if (count > 2 || (count == 2 && (words[begin + 1].quoted || (levels = atol(words[begin + 1].str().c_str())) < 1))) {
+				return fail(malformed, first.str() + ": bad loop count.");
+			}
+
+			// outside a loop it has nothing to leave: 0 levels, and a warning when it runs
+			index = add(node::jump, std::min<unsigned long>(levels, loops));
+			out.nodes[index].continues = first.is("continue");
+			return true;
+		}
+
+		if (first.is("exit")) {
+
+			if (count > 2) {
+				return fail(malformed, "exit: too many arguments.");
+			}
+
+			index = add(node::exit_shell, no_index, count == 2 ? compile_word(words[begin + 1]) : no_index);
+			return true;
+		}
+
+		size_t assignments = 0;
+
+		while (assignments < count && is_assignment(words[begin + assignments])) {
+			++assignments;
+		}
+
+		if (assignments == count) { // only assignments: they set shell variables
+
+			vector<uint32_t> items;
+
+			for (size_t i = begin; i < pos; ++i) {
+				const char* equals = static_cast<const char*>(memchr(words[i].text, '=', words[i].length));
+				word value = words[i];
+				value.text = equals + 1;
+				value.length = words[i].length - (equals + 1 - words[i].text);
+				uint32_t slot = variable_slot(string(words[i].text, equals));
+				items.push_back(add(node::assign, slot, compile_word(value)));
+			}
+
+			if (items.size() == 1) {
+				index = items[0];
+			} else {
+				index = add(node::list, out.children.size(), items.size());
+				out.children.insert(out.children.end(), items.begin(), items.end());
+			}
+
+			return true;
+		}
+
+		uint32_t start = out.words.size();
+		bool plain = true; // no pipes or redirections
+
+		// the words of a command are compiled in order, so they stay contiguous
+		for (size_t i = begin; i < pos; ++i) {
+			const compiled_word& compiled = out.words[compile_word(words[i])];
+			plain = plain && !compiled.pipe && !compiled.redirection;
+		}
+
+		index = add(node::simple, start, count);
+
+		// core builtins are never unloaded, so one named by a plain command can be called directly
+		const builtin* command = plain && out.words[start].parts == 0 ? find_builtin(out.strings[out.words[start].text]) : nullptr;
+
+		if (command != nullptr && command -> plugin == nullptr) {
+			out.nodes[index].c = out.builtins.size();
+			out.builtins.push_back(command);
+		}
+
+		return true;
+
+	}
+
+	static bool is_assignment (const word& w) {
+
+		const char* equals = static_cast<const char*>(memchr(w.text, '=', w.length));
+
+		return equals != nullptr && is_name(w.text, equals - w.text);
+
+	}
+
+	/**
+	* Compile a word into the program
+	* @return Its index in out.words
+	*/
+	uint32_t compile_word (const word& w) {
+
+		compiled_word compiled;
+		compiled.text = no_index;
+		compiled.first = out.parts.size();
+		compiled.parts = 0;
+		compiled.pipe = w.is("|");
+		compiled.redirection = !w.quoted && is_redirection(w.str());
+		compiled.forced = false; // set by compile_parts if the word has quotes
+
+		if (w.substitution) {
+			compile_parts(w.text, w.text + w.length, compiled.forced);
+			compiled.parts = out.parts.size() - compiled.first;
+		} else {
+			compiled.text = intern(w.str());
+		}
+
+		out.words.push_back(compiled);
+		return out.words.size() - 1;
+
+	}
+
+	void add_part (word_part::kind_t kind, bool quoted, uint32_t value) {
+
+		word_part part;
+		part.kind = kind;
+		part.quoted = quoted;
+		part.value = value;
+
+		out.parts.push_back(part);
+
+	}
+
+	void flush (string& literal) {
+
+		if (!literal.empty()) {
+			add_part(word_part::literal, false, intern(literal));
+			literal.clear();
+		}
+
+	}
+
+	/**
+	* Split a word as written into literal text and the parts to expand, removing quotes and escapes
+	* @param forced Set if the word had quotes
+	*/
+	void compile_parts (const char* text, const char* end, bool& forced) {
+
+		string literal;
+		char quote = 0;
+
+		for (const char* p = text; p < end; ++p) {
+
+			char c = *p;
+
+			if (quote == '\'') {
+				if (c == '\'') {
+					quote = 0;
+				} else {
+					literal += c;
+				}
+				continue;
+			}
+
+			if (c == '\\' && p + 1 < end) {
+				char next = p[1];
+				if (quote == '"' && next != '\\' && next != '"' && next != '$' && next != '`') {
+					literal += c; // backslash is literal inside double quotes
+				} else {
+					literal += next;
+					++p;
+				}
+				continue;
+			}
+
+			if ((c == '$' && p + 1 < end && p[1] == '(') || c == '`') {
+
+				const char* close = substitution_end(p, end);
+
+				flush(literal);
+
+				if (c == '$' && p[2] == '(' && close[-1] == ')' && close - 1 > p + 2) { // $((arithmetic))
+					add_part(word_part::arithmetic, quote == '"', compile_expression(p + 3, close - 1));
+					p = close;
+					continue;
+				}
+
+				string command;
+
+				if (c == '`') { // inside backticks, \` and \\ stand for ` and backslash
+					for (const char* q = p + 1; q < close; ++q) {
+						if (*q == '\\' && q + 1 < close && (q[1] == '`' || q[1] == '\\' || q[1] == '$')) {
+							++q;
+						}
+						command += *q;
+					}
+				} else {
+					command.assign(p + 2, close);
+				}
+
+				add_part(word_part::command, quote == '"', intern(command));
+				p = close;
+				continue;
+			}
+
+			if (c == '$' && p + 1 < end && (p[1] == '?' || p[1] == '$')) {
+				flush(literal);
+				add_part(p[1] == '?' ? word_part::status : word_part::shell_pid, quote == '"', 0);
+				++p;
+				continue;
+			}
+
+			if (c == '$' && p + 1 < end && (is_name_start(p[1]) || p[1] == '{')) {
+
+				const char* name = p + 1;
+				const char* name_end;
+
+				if (*name == '{') {
+					name_end = static_cast<const char*>(memchr(name, '}', end - name));
+					if (name_end == nullptr || !is_name(name + 1, name_end - name - 1)) {
+						fail(malformed, "Bad substitution " + string(p, name_end != nullptr ? name_end + 1 : end) + ".");
+						return;
+					}
+					p = name_end;
+					++name;
+				} else {
+					for (name_end = name; name_end < end && is_name_char(*name_end); ++name_end) {
+					}
+					p = name_end - 1;
+				}
+
+				flush(literal);
+				add_part(word_part::variable, quote == '"', variable_slot(string(name, name_end)));
+				continue;
+			}
+
+			if (quote == '"') {
+				if (c == '"') {
+					quote = 0;
+				} else {
+					literal += c;
+				}
+				continue;
+			}
+
+			if (c == '\'' || c == '"') {
+				quote = c;
+				forced = true;
+			} else {
+				literal += c;
+			}
+		}
+
+		flush(literal);
+
+	}
+
+	/**
+	* Compile the inside of $((...)) with the usual precedence of C
+	* @return The root of the expression
+	*/
+	uint32_t compile_expression (const char* text, const char* end) {
+
+		expr_text = text;
+		expr_end = end;
+
+		uint32_t root = parse_binary(0);
+
+		skip_expression_blanks();
+
+		if (root == no_index || expr_text != expr_end) {
+			fail(malformed, "Bad arithmetic expression " + string(text, end) + ".");
+			return 0;
+		}
+
+		return root;
+
+	}
+
+	const char* expr_text;
+	const char* expr_end;
+
+	uint32_t add_expression (expr_node::kind_t kind, char op, uint32_t left, uint32_t right, long long value) {
+
+		expr_node fresh;
+		fresh.kind = kind;
+		fresh.op = op;
+		fresh.left = left;
+		fresh.right = right;
+		fresh.value = value;
+
+		out.exprs.push_back(fresh);
+		return out.exprs.size() - 1;
+
+	}
+
+	void skip_expression_blanks () {
+
+		while (expr_text < expr_end && is_blank(*expr_text)) {
+			++expr_text;
+		}
+
+	}
+
+	/**
+	* Read a binary operator of the given precedence level or tighter
+	* @return Its code, with its precedence in level, or 0 if there is none
+	*/
+	char binary_operator (int& level) {
+
+		skip_expression_blanks();
+
+		if (expr_text == expr_end) {
+			return 0;
+		}
+
+		char c = *expr_text;
+		char next = expr_text + 1 < expr_end ? expr_text[1] : 0;
+
+		struct { char first, second, code; int level; } table[] = {
+			{ '|', '|', '|', 1 }, { '&', '&', '&', 2 }, { '=', '=', '=', 3 }, { '!', '=', '!', 3 },
+			{ '<', '=', 'l', 4 }, { '>', '=', 'g', 4 }, { '<', 0, '<', 4 }, { '>', 0, '>', 4 },
+			{ '+', 0, '+', 5 }, { '-', 0, '-', 5 }, { '*', 0, '*', 6 }, { '/', 0, '/', 6 }, { '%', 0, '%', 6 },
+		};
+
+		for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); ++i) {
+			if (table[i].first == c && (table[i].second == 0 || table[i].second == next)) {
+				level = table[i].level;
+				return table[i].code;
+			}
+		}
+
+		return 0;
+
+	}
+
+	uint32_t parse_binary (int min_level) {
+
+		uint32_t left = parse_unary();
+
+		while (left != no_index) {
+
+			const char* before = expr_text;
+			int level;
+			char op = binary_operator(level);
+
+			if (op == 0 || level <= min_level) {
+				expr_text = before;
+				break;
+			}
+
+			expr_text += (op == 'l' || op == 'g' || op == '=' || op == '!' || op == '&' || op == '|') ? 2 : 1;
+
+			uint32_t right = parse_binary(level);
+
+			if (right == no_index) {
+				return no_index;
+			}
+
+			left = add_expression(expr_node::binary, op, left, right, 0);
+		}
+
+		return left;
+
+	}
+
+	uint32_t parse_unary () {
+
+		skip_expression_blanks();
+
+		if (expr_text == expr_end) {
+			return no_index;
+		}
+
+		char c = *expr_text;
+
+		if (c == '-' || c == '!' || c == '+') {
+			++expr_text;
+			uint32_t operand = parse_unary();
+			if (operand == no_index || c == '+') {
+				return operand;
+			}
+			return add_expression(c == '-' ? expr_node::negate : expr_node::logical_not, c, operand, no_index, 0);
+		}
+
+		if (c == '(') {
+			++expr_text;
+			uint32_t inner = parse_binary(0);
+			skip_expression_blanks();
+			if (inner == no_index || expr_text == expr_end || *expr_text != ')') {
+				return no_index;
+			}
+			++expr_text;
+			return inner;
+		}
+
+		if (c >= '0' && c <= '9') {
+			long long value = 0;
+			while (expr_text < expr_end && *expr_text >= '0' && *expr_text <= '9') {
+				if (__builtin_mul_overflow(value, 10, &value) || __builtin_add_overflow(value, *expr_text++ - '0', &value)) {
+					return no_index; // out of range
+				}
+			}
+			return add_expression(expr_node::number, 0, no_index, no_index, value);
+		}
+
+		if (c == '$' && expr_text + 1 < expr_end && is_name_start(expr_text[1])) { // $name is the same as name
+			++expr_text;
+			c = *expr_text;
+		}
+
+		if (is_name_start(c)) {
+			const char* name = expr_text;
+			while (expr_text < expr_end && is_name_char(*expr_text)) {
+				++expr_text;
+			}
+			return add_expression(expr_node::variable, 0, no_index, no_index, variable_slot(string(name, expr_text)));
+		}
+
+		return no_index;
+
+	}
+
+};
+
+/**
+* Arena for the words that had quotes or escapes removed, reused for every compile
+*/
+static arena scratch;
+
+compile_result compile (const string& text, program& out, string& error) {
+
+	out.nodes.clear();
+	out.children.clear();
+	out.words.clear();
+	out.parts.clear();
+	out.exprs.clear();
+	out.strings.clear();
+	out.builtins.clear();
+	out.root = no_index;
+
+	vector<word> words;
+	scratch.clear();
+
+	if (!lex(text.data(), text.size(), words, scratch, true)) {
+		error = "Unterminated quote.";
+		return malformed;
+	}
+
+	return compiler(words, out, error).run();
+
+}
+
+/**
+* Levels of loops a break or continue still has to leave
+*/
+static unsigned jump_levels = 0;
+
+/**
+* Whether the jump continues the last loop it reaches rather than leaving it
+*/
+static bool jump_continues = false;
+
+static bool exiting = false;
+
+bool exit_requested () {
+
+	return exiting;
+
+}
+
+/**
+* Whether the rest of the enclosing lists is skipped
+*/
+static inline bool unwinding () {
+
+	return jump_levels > 0 || exiting;
+
+}
+
+/**
+* Report an arithmetic error, leaving a status of 1
+* @return 0, the value of the failed operation
+*/
+static long long arithmetic_error (const char* message) {
+
+	cerr << message << endl;
+	last_status = EXIT_FAILURE;
+	return 0;
+
+}
+
+static long long evaluate (const program& code, uint32_t index) {
+
+	const expr_node& expr = code.exprs[index];
+	long long result;
+
+	switch (expr.kind) {
+		case expr_node::number:
+			return expr.value;
+		case expr_node::variable:
+			errno = 0;
+			result = strtoll(variables[expr.value].c_str(), nullptr, 10);
+			return errno == ERANGE ? arithmetic_error("Arithmetic overflow.") : result;
+		case expr_node::negate:
+			result = evaluate(code, expr.left);
+			return result == LLONG_MIN ? arithmetic_error("Arithmetic overflow.") : -result;
+		case expr_node::logical_not:
+			return !evaluate(code, expr.left);
+		case expr_node::binary:
+			break;
+	}
+
+	long long left = evaluate(code, expr.left);
+
+	if (expr.op == '&' || expr.op == '|') { // short-circuit
+		return expr.op == '&' ? left && evaluate(code, expr.right) : left || evaluate(code, expr.right);
+	}
+
+	long long right = evaluate(code, expr.right);
+
+	switch (expr.op) {
+		case '+':
+			return __builtin_add_overflow(left, right, &result) ? arithmetic_error("Arithmetic overflow.") : result;
+		case '-':
+			return __builtin_sub_overflow(left, right, &result) ? arithmetic_error("Arithmetic overflow.") : result;
+		case '*':
+			return __builtin_mul_overflow(left, right, &result) ? arithmetic_error("Arithmetic overflow.") : result;
+		case '/':
+		case '%':
+			if (right == 0) {
+				return arithmetic_error("Division by zero.");
+			}
+			if (left == LLONG_MIN && right == -1) { // the quotient does not fit, and the CPU traps
+				return expr.op == '%' ? 0 : arithmetic_error("Arithmetic overflow.");
+			}
+			return expr.op == '/' ? left / right : left % right;
+		case '<': return left < right;
+		case '>': return left > right;
+		case 'l': return left <= right;
+		case 'g': return left >= right;
+		case '=': return left == right;
+		case '!': return left != right;
+	}
+
+	return 0;
+
+}
+
+/**
+* The value of a variable, $?, $$ or an arithmetic expansion
+* @param number Holds the text of a number
+*/
+static const string& part_value (const program& code, const word_part& part, string& number) {
+
+	switch (part.kind) {
+		case word_part::variable:
+			return variables[part.value];
+		case word_part::status:
+			number = std::to_string(last_status);
+			break;
+		case word_part::shell_pid:
+			number = std::to_string(getpid());
+			break;
+		default:
+			number = std::to_string(evaluate(code, part.value));
+			break;
+	}
+
+	return number;
+
+}
+
+/**
+* The words a command expands to. The strings left by the previous command are overwritten
+* rather than freed, so a loop running the same command again does not allocate
+*/
+struct field_list {
+
+	vector<string>& strings;
+	size_t used;
+
+	/**
+	* @return A new, empty field at the end
+	*/
+	string& add () {
+
+		if (used == strings.size()) {
+			strings.push_back(string());
+		} else {
+			strings[used].clear();
+		}
+
+		return strings[used++];
+
+	}
+
+	string& last () {
+
+		return strings[used - 1];
+
+	}
+
+	/**
+	* Drop the unused strings once every word was expanded
+	*/
+	void finish () {
+
+		strings.resize(used);
+
+	}
+
+};
+
+/**
+* Append an expansion to the word being built, the last of the fields.
+* Unless it was quoted, it is split into more words at blanks
+* @param have_word Whether the last field is a word already
+*/
+static void append_expansion (field_list& fields, const char* data, size_t length, bool quoted, bool& have_word) {
+
+	if (quoted) {
+		fields.last().append(data, length);
+		have_word = true;
+		return;
+	}
+
+	for (size_t i = 0; i < length; ) {
+
+		size_t run = i;
+
+		while (run < length && !is_blank(data[run])) {
+			++run;
+		}
+
+		if (run > i) { // a run of word characters
+			fields.last().append(data + i, run - i);
+			have_word = true;
+			i = run;
+		} else { // a blank ends the word, if there is one
+			if (have_word) {
+				fields.add();
+				have_word = false;
+			}
+			++i;
+		}
+	}
+
+}
+
+/**
+* Expand a compiled word into fields
+*/
+static void expand (const program& code, const compiled_word& w, field_list& fields) {
+
+	if (w.parts == 0) {
+		fields.add() = code.strings[w.text];
+		return;
+	}
+
+	string number;
+	bool have_word = w.forced; // quotes make a word even when it ends up empty
+
+	fields.add(); // the word being built is always the last field
+
+	for (uint32_t i = w.first; i < w.first + w.parts; ++i) {
+
+		const word_part& part = code.parts[i];
+
+		if (part.kind == word_part::literal) {
+			fields.last() += code.strings[part.value];
+			have_word = true;
+		} else if (part.kind == word_part::command) {
+			arena output;
+			size_t length;
+			const char* data = capture(code.strings[part.value], output, length);
+			append_expansion(fields, data != nullptr ? data : "", length, part.quoted, have_word);
+		} else {
+			const string& value = part_value(code, part, number);
+			append_expansion(fields, value.data(), value.size(), part.quoted, have_word);
+		}
+	}
+
+	if (!have_word) {
+		fields.used--;
+	}
+
+}
+
+/**
+* Expand a word into one string, without splitting it
+* @param value Receives the string
+*/
+static void expand_value (const program& code, const compiled_word& w, string& value) {
+
+	if (w.parts == 0) {
+		value = code.strings[w.text];
+		return;
+	}
+
+	string number;
+
+	value.clear();
+
+	for (uint32_t i = w.first; i < w.first + w.parts; ++i) {
+
+		const word_part& part = code.parts[i];
+
+		if (part.kind == word_part::literal) {
+			value += code.strings[part.value];
+		} else if (part.kind == word_part::command) {
+			arena output;
+			size_t length;
+			const char* data = capture(code.strings[part.value], output, length);
+			value.append(data != nullptr ? data : "", length);
+		} else {
+			value += part_value(code, part, number);
+		}
+	}
+
+}
+
+/**
+* Whether a loop that just ran its condition or body stops because of a jump
+*/
+static bool leave_loop () {
+
+	if (exiting) {
+		return true;
+	}
+
+	if (jump_levels == 0) {
+		return false;
+	}
+
+	if (--jump_levels > 0 || !jump_continues) {
+		return true; // leave this loop, and outer ones if levels remain
+	}
+
+	return false; // continue this loop
+
+}
+
+static void run (const program& code, uint32_t index) {
+
+	const node& current = code.nodes[index];
+
+	switch (current.kind) {
+
+		case node::list:
+			for (uint32_t i = current.a; i < current.a + current.b && !unwinding(); ++i) {
+				run(code, code.children[i]);
+			}
+			break;
+
+		case node::simple: {
+
+			// kept between commands so that their storage is reused; a command substitution
+			// that runs more commands does so in a forked subshell, with its own copy
+			static vector<string> tokens;
+			static vector<size_t> pipes;
+			field_list fields = { tokens, 0 };
+			bool redir = false;
+
+			pipes.clear();
+
+			for (uint32_t i = current.a; i < current.a + current.b; ++i) {
+				const compiled_word& w = code.words[i];
+				if (w.pipe) {
+					pipes.push_back(fields.used);
+				}
+				redir = redir || w.redirection;
+				expand(code, w, fields);
+			}
+
+			fields.finish();
+
+			if (current.c != no_index && !tokens.empty()) { // no job prefixes to take apart
+				last_status = EXIT_SUCCESS;
+				call_builtin(*code.builtins[current.c], tokens, true, false);
+			} else {
+				runner(tokens, redir, pipes);
+			}
+			break;
+		}
+
+		case node::assign: {
+			string value; // the old value may be part of the new one
+			last_status = EXIT_SUCCESS; // unless a command substitution fails
+			expand_value(code, code.words[current.b], value);
+			variables[current.a].swap(value);
+			break;
+		}
+
+		case node::if_clause:
+			run(code, current.a);
+			if (unwinding()) {
+				break;
+			}
+			if (last_status == EXIT_SUCCESS) {
+				run(code, current.b);
+			} else if (current.c != no_index) {
+				run(code, current.c);
+			} else {
+				last_status = EXIT_SUCCESS;
+			}
+			break;
+
+		case node::while_clause:
+		case node::until_clause: {
+
+			int status = EXIT_SUCCESS;
+
+			while (true) {
+
+				reaper_dispatch(); // children may terminate while a long loop runs
+
+				run(code, current.a);
+
+				if (leave_loop()) {
+					break;
+				}
+
+				if ((last_status == EXIT_SUCCESS) != (current.kind == node::while_clause)) {
+					break;
+				}
+
+				run(code, current.b);
+				status = last_status;
+
+				if (leave_loop()) {
+					break;
+				}
+			}
+
+			last_status = status;
+			break;
+		}
+
+		case node::for_clause: {
+
+			vector<string> items;
+			field_list fields = { items, 0 };
+			int status = EXIT_SUCCESS;
+
+			for (uint32_t i = current.c; i < current.c + current.d; ++i) {
+				expand(code, code.words[i], fields);
+			}
+
+			fields.finish();
+
+			for (vector<string>::iterator item = items.begin(); item != items.end(); item++) {
+
+				reaper_dispatch();
+
+				variables[current.a].swap(*item);
+				run(code, current.b);
+				status = last_status;
+
+				if (leave_loop()) {
+					break;
+				}
+			}
+
+			last_status = status;
+			break;
+		}
+
+		case node::jump:
+			if (current.a == 0) {
+				cerr << (current.continues ? "continue" : "break") << ": only meaningful in a for, while or until loop" << endl;
+				break;
+			}
+			jump_levels = current.a;
+			jump_continues = current.continues;
+			break;
+
+		case node::exit_shell:
+			if (current.b != no_index) {
+				string status;
+				expand_value(code, code.words[current.b], status);
+				char* end = nullptr;
+				errno = 0;
+				long value = strtol(status.c_str(), &end, 10);
+				if (status.empty() || *end != '\0' || errno == ERANGE) {
+					cerr << "exit: numeric argument required" << endl;
+					last_status = 2;
+				} else {
+					last_status = value & 0xff; // what the parent sees of it
+				}
+			}
+			exiting = true;
+			break;
+	}
+
+}
+
+void execute (const program& code, bool stop_on_error) {
+
+	if (code.root == no_index) {
+		return;
+	}
+
+	const node& root = code.nodes[code.root];
+
+	if (!stop_on_error || root.kind != node::list) {
+		run(code, code.root);
+		return;
+	}
+
+	for (uint32_t i = root.a; i < root.a + root.b && !unwinding(); ++i) {
+		run(code, code.children[i]);
+		if (last_status != EXIT_SUCCESS) {
+			break;
+		}
+	}
+
+}
+
+/**
+* Parse an integer operand of test
+*/
+static bool test_integer (const string& text, long long& value) {
+
+	char* end = nullptr;
+	errno = 0;
+	value = strtoll(text.c_str(), &end, 10);
+
+	if (text.empty() || *end != '\0') {
+		cerr << "test: integer expected: " << text << endl;
+		return false;
+	}
+
+	if (errno == ERANGE) {
+		cerr << "test: integer out of range: " << text << endl;
+		return false;
+	}
+
+	return true;
+
+}
+
+/**
+* The integer comparisons of test
+* @return 1 to 6 for -eq, -ne, -lt, -le, -gt and -ge, 0 for any other operator
+*/
+static int integer_comparison (const char* op) {
+
+	static const char* const names[] = { "-eq", "-ne", "-lt", "-le", "-gt", "-ge" };
+
+	if (op[0] != '-') {
+		return 0;
+	}
+
+	for (int i = 0; i < 6; ++i) {
+		if (strcmp(op, names[i]) == 0) {
+			return i + 1;
+		}
+	}
+
+	return 0;
+
+}
+
+void test (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	size_t end = tokens.size();
+
+	if (tokens[0] == "[") {
+		if (tokens.back() != "]") {
+			cerr << "[: missing ]\n";
+			last_status = 2;
+			return;
+		}
+		--end;
+	}
+
+	size_t i = 1;
+	bool negate = false;
+
+	if (end - i > 1 && tokens[i] == "!") {
+		negate = true;
+		++i;
+	}
+
+	bool holds = false;
+	size_t operands = end - i;
+
+	if (operands == 1) {
+
+		holds = !tokens[i].empty();
+
+	} else if (operands == 2) {
+
+		const string& op = tokens[i];
+		const string& operand = tokens[i + 1];
+		struct stat info;
+
+		if (op == "-n" || op == "-z") {
+			holds = operand.empty() == (op == "-z");
+		} else if (op == "-e" || op == "-f" || op == "-d") {
+			holds = stat(operand.c_str(), &info) == 0
+			        && (op == "-e" || (op == "-f" ? S_ISREG(info.st_mode) : S_ISDIR(info.st_mode)));
+		} else {
+			cerr << "test: unknown condition " << op << endl;
+			last_status = 2;
+			return;
+		}
+
+	} else if (operands == 3) {
+
+		const char* op = tokens[i + 1].c_str();
+		int comparison = integer_comparison(op);
+		long long left, right;
+
+		if (comparison != 0) {
+			if (!test_integer(tokens[i], left) || !test_integer(tokens[i + 2], right)) {
+				last_status = 2;
+				return;
+			}
+			holds = comparison == 1 ? left == right : comparison == 2 ? left != right
+			      : comparison == 3 ? left < right : comparison == 4 ? left <= right
+			      : comparison == 5 ? left > right : left >= right;
+		} else if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) {
+			holds = (tokens[i] == tokens[i + 2]) == (op[0] != '!');
+		} else {
+			cerr << "test: unknown operator " << op << endl;
+			last_status = 2;
+			return;
+		}
+
+	} else if (operands > 3) {
+
+		cerr << "test: too many arguments\n";
+		last_status = 2;
+		return;
+	}
+
+	last_status = holds != negate ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
+
+void true_command (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	last_status = EXIT_SUCCESS;
+
+}
+
+void false_command (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	last_status = EXIT_FAILURE;
+
+}
+
+}
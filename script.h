@@ -0,0 +1,150 @@
+#ifndef _SCRIPT_H_
+#define _SCRIPT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+struct builtin;
+
+/**
+* Runs one simple command after its words were expanded
+* @param tokens The command and its arguments
+* @param redir Whether it contains an unquoted redirection operator
+* @param pipes The indices of its unquoted "|" tokens
+*/
+typedef void (*command_runner) (vector<string>& tokens, bool redir, vector<size_t>& pipes);
+
+/**
+* Set the function simple commands are run with
+* @param runner The shell's command runner
+*/
+void set_command_runner (command_runner runner);
+
+/**
+* A part of a word that is expanded each time the command runs
+*/
+struct word_part {
+	enum kind_t : uint8_t { literal, variable, status, shell_pid, arithmetic, command } kind;
+	bool quoted;    // inside double quotes, so never split into words
+	uint32_t value; // string of a literal or a command, slot of a variable, root of an expression
+};
+
+/**
+* A word of a compiled command: either one interned string, or parts to expand
+*/
+struct compiled_word {
+	uint32_t text;  // the interned word when it has no parts
+	uint32_t first; // first part
+	uint32_t parts; // number of parts, 0 for a literal word
+	bool pipe;      // an unquoted "|"
+	bool redirection; // an unquoted redirection operator
+	bool forced;    // had quotes, so it makes a word even when it expands to nothing
+};
+
+/**
+* A node of an arithmetic expression
+*/
+struct expr_node {
+	enum kind_t : uint8_t { number, variable, negate, logical_not, binary } kind;
+	char op;       // of a binary node: + - * / % < > l(<=) g(>=) = (==) ! (!=) & (&&) | (||)
+	uint32_t left;  // operand of a unary node, left operand of a binary one
+	uint32_t right;
+	long long value; // of a number, or the slot of a variable
+};
+
+/**
+* A node of a compiled program
+*/
+struct node {
+	enum kind_t : uint8_t { list, simple, assign, if_clause, while_clause, until_clause, for_clause, jump, exit_shell } kind;
+	bool continues; // of a jump: continue rather than break
+	uint32_t a;     // list, simple: first child or word; if, while: condition; for, assign: variable slot; jump: levels, 0 outside loops
+	uint32_t b;     // list, simple: number of children or words; if, while, for: body; assign, exit: word
+	uint32_t c;     // if: else branch; for: first word of the list; simple: its core builtin, if resolved
+	uint32_t d;     // for: number of words in the list
+};
+
+/**
+* Index standing for no node or no word
+*/
+const uint32_t no_index = UINT32_MAX;
+
+/**
+* A piece of input compiled once into a tree whose nodes, words and expressions live in flat
+* arrays and refer to each other by index. Words are interned, variables are resolved to
+* slots and core builtins to their entries, so running a loop body again neither lexes
+* nor looks anything up by name
+*/
+struct program {
+	vector<node> nodes;
+	vector<uint32_t> children; // of list nodes
+	vector<compiled_word> words;
+	vector<word_part> parts;
+	vector<expr_node> exprs;
+	vector<string> strings;    // interned
+	vector<const builtin*> builtins; // core builtins named by simple commands
+	uint32_t root;
+};
+
+/**
+* The outcome of compiling a piece of input
+*/
+enum compile_result { compiled, incomplete, malformed };
+
+/**
+* Compile commands separated by ; or newlines, with if/elif/else/fi, while/until/do/done,
+* for name in words; do/done, break and continue [n], exit [n] and name=value assignments.
+* Words may refer to $name, ${name}, $?, $$, $((arithmetic)), $(command) and `command`
+* @param text The input
+* @param out Receives the program
+* @param error Receives a message when the input cannot be compiled
+* @return incomplete if more input could complete a construct left open
+*/
+compile_result compile (const string& text, program& out, string& error);
+
+/**
+* Run a compiled program, leaving the status of its last command in last_status
+* @param code The program
+* @param stop_on_error Whether to stop at the first top-level command that fails
+*/
+void execute (const program& code, bool stop_on_error = false);
+
+/**
+* @return Whether a program ran exit
+*/
+bool exit_requested ();
+
+/**
+* Command that evaluates a condition, also named [ with a closing ]:
+* -n, -z, =, != on strings, -eq, -ne, -lt, -le, -gt, -ge on integers, -e, -f, -d on paths and ! to negate
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void test (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+/**
+* Command that does nothing and succeeds, also named :
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void true_command (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+/**
+* Command that does nothing and fails
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void false_command (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+#include "shmjobs.h"
+#include "jobs.h"
+#include "reaper.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace ss {
+
+static_assert(sizeof(ss_jobshm_record) == 192, "the record layout is part of the ABI");
+
+/**
+* Records the table starts with; it doubles when they are all in use
+*/
+static const uint32_t initial_capacity = 1024;
+
+static ss_jobshm_header* header = nullptr;
+
+static int shm_fd = -1;
+
+static string shm_name;
+
+/**
+* Records no job holds, below header -> used
+*/
+static std::vector<uint32_t> free_records;
+
+static size_t segment_size (uint32_t capacity) {
+
+	return sizeof(ss_jobshm_header) + size_t(capacity) * sizeof(ss_jobshm_record);
+
+}
+
+static ss_jobshm_record* record (uint32_t slot) {
+
+	return reinterpret_cast<ss_jobshm_record*>(header + 1) + slot;
+
+}
+
+static void remove_segment () {
+
+	if (header != nullptr && header -> shell_pid == getpid()) { // not from a subshell
+		shm_unlink(shm_name.c_str());
+	}
+
+}
+
+bool shared_jobs_open () {
+
+	shm_name = "/" SS_JOBSHM_PREFIX + std::to_string(getpid());
+	shm_fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+	if (shm_fd == -1) {
+		return false;
+	}
+
+	void* mapped = MAP_FAILED;
+
+	if (ftruncate(shm_fd, segment_size(initial_capacity)) == 0) {
+		mapped = mmap(nullptr, segment_size(initial_capacity), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+	}
+
+	if (mapped == MAP_FAILED) {
+		close(shm_fd);
+		shm_fd = -1;
+		shm_unlink(shm_name.c_str());
+		return false;
+	}
+
+	header = static_cast<ss_jobshm_header*>(mapped);
+	header -> version = SS_JOBSHM_VERSION;
+	header -> record_size = sizeof(ss_jobshm_record);
+	header -> capacity = initial_capacity;
+	header -> used = 0;
+	header -> shell_pid = getpid();
+	header -> generation = 0;
+	__atomic_store_n(&header -> magic, SS_JOBSHM_MAGIC, __ATOMIC_RELEASE); // readers check it last
+
+	atexit(remove_segment);
+	return true;
+
+}
+
+void shared_jobs_detach () {
+
+	if (header != nullptr) {
+		munmap(header, segment_size(header -> capacity));
+		close(shm_fd);
+		header = nullptr;
+		shm_fd = -1;
+	}
+
+}
+
+/**
+* Take a free record, growing the segment when there is none
+* @return The record's index, or UINT32_MAX if the segment cannot grow
+*/
+static uint32_t allocate () {
+
+	if (!free_records.empty()) {
+		uint32_t slot = free_records.back();
+		free_records.pop_back();
+		return slot;
+	}
+
+	uint32_t capacity = header -> capacity;
+
+	if (header -> used == capacity) {
+
+		void* grown = MAP_FAILED;
+
+		if (ftruncate(shm_fd, segment_size(capacity * 2)) == 0) {
+			grown = mremap(header, segment_size(capacity), segment_size(capacity * 2), MREMAP_MAYMOVE);
+		}
+
+		if (grown == MAP_FAILED) {
+			return UINT32_MAX;
+		}
+
+		header = static_cast<ss_jobshm_header*>(grown);
+		__atomic_store_n(&header -> capacity, capacity * 2, __ATOMIC_RELEASE);
+	}
+
+	return header -> used++;
+
+}
+
+/**
+* @return A monotonic time converted to ns of wall clock time
+*/
+static int64_t wall_ns (double monotonic) {
+
+	struct timespec real;
+	clock_gettime(CLOCK_REALTIME, &real);
+
+	return int64_t(real.tv_sec) * 1000000000 + real.tv_nsec - int64_t((monotonic_now() - monotonic) * 1e9);
+
+}
+
+static int64_t microseconds (const struct timeval& tv) {
+
+	return int64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+
+}
+
+void shared_jobs_publish (process& entry) {
+
+	if (header == nullptr) {
+		return;
+	}
+
+	if (entry.shared_slot == UINT32_MAX && (entry.shared_slot = allocate()) == UINT32_MAX) {
+		return; // out of memory: the job is left out of the table
+	}
+
+	ss_jobshm_record* r = record(entry.shared_slot);
+	uint32_t seq = r -> seq;
+
+	__atomic_store_n(&r -> seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	r -> pid = entry.pid;
+	r -> id = entry.id;
+	r -> state = !entry.reaped ? SS_JOB_RUNNING : entry.state > 0 ? SS_JOB_SIGNALED : SS_JOB_EXITED;
+	r -> status = entry.state > 0 ? entry.state : entry.exit_code;
+	r -> start_ns = wall_ns(entry.launched);
+	r -> end_ns = entry.reaped ? wall_ns(entry.finished != 0 ? entry.finished : monotonic_now()) : 0;
+	r -> utime_us = microseconds(entry.usage.ru_utime);
+	r -> stime_us = microseconds(entry.usage.ru_stime);
+	r -> maxrss_kb = entry.usage.ru_maxrss;
+	r -> minflt = entry.usage.ru_minflt;
+	r -> majflt = entry.usage.ru_majflt;
+	r -> nvcsw = entry.usage.ru_nvcsw;
+	r -> nivcsw = entry.usage.ru_nivcsw;
+	r -> stages = entry.stages.empty() ? 1 : entry.stages.size();
+
+	size_t length = 0;
+	for (vector<string>::const_iterator token = entry.tokens.cbegin(); token != entry.tokens.cend(); token++) {
+		if (length > 0 && length + 1 < sizeof(r -> command)) {
+			r -> command[length++] = ' ';
+		}
+		size_t n = std::min(token -> size(), sizeof(r -> command) - 1 - length);
+		memcpy(r -> command + length, token -> data(), n);
+		length += n;
+	}
+	r -> command[length] = '\0';
+
+	__atomic_store_n(&r -> seq, seq + 2, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&header -> generation, 1, __ATOMIC_RELEASE);
+
+}
+
+void shared_jobs_release (process& entry) {
+
+	if (header == nullptr || entry.shared_slot == UINT32_MAX) {
+		return;
+	}
+
+	ss_jobshm_record* r = record(entry.shared_slot);
+	uint32_t seq = r -> seq;
+
+	__atomic_store_n(&r -> seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	r -> pid = 0;
+	__atomic_store_n(&r -> seq, seq + 2, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&header -> generation, 1, __ATOMIC_RELEASE);
+
+	free_records.push_back(entry.shared_slot);
+	entry.shared_slot = UINT32_MAX;
+
+}
+
+}
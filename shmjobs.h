@@ -0,0 +1,35 @@
+#ifndef _SHMJOBS_H_
+#define _SHMJOBS_H_
+
+#include "ss_jobshm.h"
+
+namespace ss {
+
+struct process;
+
+/**
+* Create the shell's shared-memory job table, /dev/shm/simple_shell.<pid>, readable by everyone.
+* It is removed when the shell exits
+* @return false if it could not be created; the shell then runs without it
+*/
+bool shared_jobs_open ();
+
+/**
+* Drop the mapping in a forked subshell, whose jobs are not the shell's
+*/
+void shared_jobs_detach ();
+
+/**
+* Write a job's record, giving it one first if needed. Does nothing without a table
+* @param entry The job, as stored in ps
+*/
+void shared_jobs_publish (process& entry);
+
+/**
+* Free a job's record once the job leaves ps
+*/
+void shared_jobs_release (process& entry);
+
+}
+
+#endif
@@ -1,172 +1,378 @@
 #include <unistd.h>
+#include <climits>
 #include <cstdlib>
 #include <cstdio>
 #include <cerrno>
 #include <iostream>
 #include <string>
 #include <vector>
-#include <map>
 #include <csignal>
 #include <algorithm>
 
 #include "cmds.h"
+#include "reaper.h"
+#include "lexer.h"
+#include "pipeline.h"
+#include "input.h"
+#include "parallel.h"
+#include "stats.h"
+#include "pathcache.h"
+#include "redirect.h"
+#include "subst.h"
+#include "affinity.h"
+#include "shmjobs.h"
+#include "script.h"
 
 using std::cout;
+using std::cerr;
 using std::endl;
 using std::string;
 using std::vector;
-using std::map;
-using std::pair;
 
 /**
-* Define the function pointer type for the functions supporting commands with arguments
+* Choose the CPUs of the next job from --cpus or --numa-node.
+* auto spreads successive jobs over the cores, or the nodes, least used by the running ones
+* @param option --cpus or --numa-node
+* @param value A CPU list, a node number or auto
+* @return false if the value names no usable CPU
 */
-typedef void (*func_ptr) (vector<string>&, bool, bool);
+bool parse_placement (const string& option, const string& value) {
+
+	bool by_node = option == "--numa-node";
+	bool placed = true;
+
+	if (value == "auto") {
+		ss::spread_cpus(by_node, ss::ps, ss::options.cpus);
+	} else if (by_node) {
+		char* end = nullptr;
+		long node = strtol(value.c_str(), &end, 10);
+		placed = end != value.c_str() && *end == '\0' && node >= 0 && ss::node_cpus(node, ss::options.cpus);
+	} else {
+		cpu_set_t usable;
+		placed = ss::parse_cpu_list(value, ss::options.cpus) && sched_getaffinity(0, sizeof(usable), &usable) == 0;
+		if (placed) { // only the CPUs the shell may use itself
+			CPU_AND(&ss::options.cpus, &ss::options.cpus, &usable);
+			placed = CPU_COUNT(&ss::options.cpus) > 0;
+		}
+	}
 
-/**
-* Define the function pointer type for the functions supporting commands without arguments
-*/
-typedef void (*func_ptr1) (bool, bool);
+	if (!placed) {
+		cerr << "No usable CPU in " << option << " " << value << endl;
+		return false;
+	}
 
-/**
-* Pairs of supported commands that take arguments and their corresponding functions
-*/
-map<string, func_ptr> commands;
+	ss::options.pinned = true;
+	return true;
+}
 
 /**
-* Pairs of supported commands that do not take arguments and their corresponding functions
+* Consume the per-job options that follow the fg/bg specifier
+* @param tokens The command, starting with the options
+* @return false if an option is not recognized
 */
-map<string, func_ptr1> commands_wo_args;
+bool parse_job_options (vector<string>& tokens) {
 
-/**
-* Initialize the map of <command, func_ptr> pairs
-*/
-void cmd_initialize () {
+	const string restart_opt = "--restart=";
+
+	while (!tokens.empty() && tokens[0].compare(0, 2, "--") == 0) {
+
+		string option = tokens[0].substr(0, tokens[0].find('='));
+
+		if (option == "--cpus" || option == "--numa-node") { // --cpus=0-7 or --cpus 0-7
+
+			bool separate = option.size() == tokens[0].size();
+
+			if (separate && tokens.size() < 2) {
+				cerr << "Missing value for " << option << endl;
+				return false;
+			}
+
+			if (!parse_placement(option, separate ? tokens[1] : tokens[0].substr(option.size() + 1))) {
+				return false;
+			}
+
+			if (separate) {
+				tokens.erase(tokens.begin());
+			}
+
+		} else if (option == "--capture") { // --capture or --capture=<ring size>
+
+			rlim_t size = ss::default_capture_size;
+
+			if (option.size() < tokens[0].size() && (!ss::parse_size(tokens[0].substr(option.size() + 1), size) || size > ss::max_capture_size)) {
+				cerr << "Bad capture size in " << tokens[0] << ". Use up to 64M.\n";
+				return false;
+			}
+
+			ss::options.capture = size;
+
+		} else if (option == "--spill" && option.size() < tokens[0].size()) { // with --capture: keep everything in a rotating log
 
-	// commands with arguments
-	commands.insert(pair<string, func_ptr>("ls", ss::ls));
-	commands.insert(pair<string, func_ptr>("cd", ss::cd));
-	commands.insert(pair<string, func_ptr>("query", ss::query));
+			ss::options.spill = tokens[0].substr(option.size() + 1);
 
-	//commands without arguments
-	commands_wo_args.insert(pair<string, func_ptr1>("show", ss::show_pids));
-	commands_wo_args.insert(pair<string, func_ptr1>("clear", ss::clear_screen));
+		} else if (tokens[0].compare(0, restart_opt.size(), restart_opt) == 0) {
+
+			string policy = tokens[0].substr(restart_opt.size());
+
+			if (policy == "never") {
+				ss::options.restart = ss::restart_never;
+			} else if (policy == "signal") {
+				ss::options.restart = ss::restart_on_signal;
+			} else if (policy == "failure") {
+				ss::options.restart = ss::restart_on_failure;
+			} else if (policy == "always") {
+				ss::options.restart = ss::restart_always;
+			} else {
+				cerr << "Unknown restart policy " << policy << ". Use never, signal, failure or always.\n";
+				return false;
+			}
+
+		} else {
+			cerr << "Unknown option " << tokens[0] << endl;
+			return false;
+		}
+
+		tokens.erase(tokens.begin());
+	}
+
+	return true;
 }
 
 /**
-* Split the command into tokens using a delimiter
-*
-* @param src The source string
-* @param delim The delimiter used to split the source string
-* @param dst A vector of tokens resulted from splitting the string
+* Run a simple command whose words were expanded, leaving its exit status in ss::last_status
+* @param tokens The command, with its fg/bg specifier, job options and prefixes
+* @param redir Whether it contains an unquoted redirection operator
+* @param pipes The indices of its unquoted "|" tokens
 */
-void tokenize (string& src, string delim, std::vector<string>& dst) {
-	size_t pos = 0;
-	string token;
+void run_tokens (vector<string>& tokens, bool redir, vector<size_t>& pipes) {
+
+	bool fg_param_present = true; // whether the user explicitly specifies foreground/background mode
+	bool run_in_fg = true; // run job in foreground/background mode
+
+	if (tokens.empty()) {
+		return; // expanded to nothing
+	}
+
+	/* determine running mode: foreground or background */
+	if(tokens[0] == "bg") { 
+		run_in_fg = false;
+	} else {
+		if (tokens[0] != "fg") {
+			fg_param_present = false;
+		}
+	}
+
+	/* discard fg/bg specifier and apply the options that follow it */
+	if (fg_param_present) {
+		size_t before = tokens.size();
+
+		tokens.erase(tokens.begin()); 
+
+		bool parsed = parse_job_options(tokens);
+
+		for (vector<size_t>::iterator pipe = pipes.begin(); pipe != pipes.end(); pipe++) {
+			*pipe -= before - tokens.size(); // keep pipe positions in step with the tokens
+		}
+
+		if (parsed && !ss::options.spill.empty() && ss::options.capture == 0) {
+			cerr << "--spill needs --capture.\n";
+			parsed = false;
+		}
+
+		if (!parsed) {
+			ss::reset_options();
+			ss::last_status = EXIT_FAILURE;
+			return;
+		}
+	}
 
-	while ((pos = src.find(delim)) != std::string::npos) {
-		token = src.substr(0, pos);
-		if (!token.empty()) { // eliminate spaces before the first token
-			dst.push_back(token);
+	/* time and limit prefixes, in either order */
+	while (!tokens.empty() && (tokens[0] == "time" || tokens[0] == "limit")) {
+
+		size_t before = tokens.size();
+
+		if (tokens[0] == "time") { // report timings when the job is reaped
+			tokens.erase(tokens.begin());
+			ss::options.timed = true;
+		} else if (!ss::parse_limits(tokens, ss::options.limits)) { // applied by the child before exec
+			ss::reset_options();
+			ss::last_status = EXIT_FAILURE;
+			return;
+		}
+
+		for (vector<size_t>::iterator pipe = pipes.begin(); pipe != pipes.end(); pipe++) {
+			*pipe -= before - tokens.size();
 		}
-		src.erase(0, pos + delim.length());
 	}
 
-	if (!src.empty()) {
-		dst.push_back(src);
+	if (tokens.empty()) {
+		ss::reset_options();
+		return; // nothing to run
 	}
+
+	ss::last_status = EXIT_SUCCESS; // commands only set it when they fail or wait for a child
+
+	// jobs report their own timings when reaped, builtins are timed here
+	const ss::process* newest = ss::ps.newest();
+	unsigned long last_id = newest != nullptr ? newest -> id : 0;
+	double start = ss::monotonic_now();
+
+	/* run the command */
+	if (pipes.empty()) {
+		ss::run_command(tokens, run_in_fg, redir);
+	} else {
+		ss::run_pipeline(tokens, pipes, run_in_fg);
+	}
+
+	newest = ss::ps.newest();
+
+	if (ss::options.timed && (newest == nullptr || newest -> id == last_id)) { // no job was launched
+		cerr << std::fixed << "real " << ss::monotonic_now() - start << "s  (builtin)  exit " << ss::last_status << endl;
+		cerr.unsetf(std::ios_base::floatfield);
+	}
+
+	/* reset options for the next command */
+	ss::reset_options();
+
 }
 
 /**
-* Take the command and run it, if it exists
-* @param tokens A list of tokens from the command string the user entered 
-* @param run_in_fg Specification of whether this job should be run in the foreground or not
+* Compile a command line and run it, leaving its exit status in ss::last_status
+* @param command The command line, which may hold several commands and whole constructs
 */
-void run_command (vector<string>& tokens, bool run_in_fg, bool redir) {
-
-	if(commands.find(tokens[0]) != commands.end()) { // command exists
-		commands[tokens[0]](tokens, run_in_fg, redir);
-	} else if(commands_wo_args.find(tokens[0]) != commands_wo_args.end()) { // command w/o arguments exists
-		commands_wo_args[tokens[0]](run_in_fg, redir);
-	} else { // command not exists
-		cout << "Command not supported." << endl;
+void run_line (const string& command) {
+
+	ss::program code;
+	string error;
+
+	if (ss::compile(command, code, error) != ss::compiled) {
+		cerr << error << endl;
+		ss::last_status = EXIT_FAILURE;
+		return;
 	}
 
+	ss::execute(code);
+
 }
 
-int main() {
+/**
+* Print how to invoke the shell
+*/
+void usage (const char* name) {
+
+	cerr << "Usage: " << name << " [-e] [-c <command> | <script>]\n";
+	cerr << "  -c <command>  run the given command line(s) and exit\n";
+	cerr << "  <script>      run the commands in a file and exit\n";
+	cerr << "  -e            stop at the first command that fails\n";
+	cerr << "Without -c or a script, commands are read from stdin; the prompt is only shown on a terminal.\n";
+
+}
+
+int main(int argc, char* argv[]) {
+
+	bool stop_on_error = false; // -e
+	const char* script = nullptr;
+	const char* inline_command = nullptr; // -c
+
+	for (int i = 1; i < argc; ++i) {
+
+		string arg = argv[i];
+
+		if (arg == "-e") {
+			stop_on_error = true;
+		} else if (arg == "-c" && i + 1 < argc && inline_command == nullptr && script == nullptr) {
+			inline_command = argv[++i];
+		} else if (arg[0] != '-' && inline_command == nullptr && script == nullptr) {
+			script = argv[i];
+		} else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (inline_command != nullptr) { // the command is the whole input
+		ss::input_from_string(inline_command);
+	} else if (script != nullptr) {
+		if (!ss::input_from_file(script)) {
+			perror(script);
+			return 127;
+		}
+	}
+
+	// prompts are for people at a terminal only
+	bool interactive = ss::input_is_terminal();
 
 	// buffer for getting the current directory
-	char cur_buf[300]; 
+	char cur_buf[PATH_MAX]; 
 
 	string cur_dir; // current directory string 
 	string command; // command string
-	string exit = "exit"; // command for exit
-
-	// a list of tokens from the user input
-	vector<string> tokens; 
+	string source; // lines of a construct that is not complete yet
+	string error; // why the input could not be compiled
+	ss::program code; // the compiled input
 
 	// set up signal handler
-	signal(SIGCHLD, ss::ch_handler);
-
-	// initialize maps of supported commands 
-	cmd_initialize();
-	ss::cmd_initialize();
+	ss::reaper_initialize();
+	ss::shared_jobs_open(); // for monitors, optional
+	ss::set_line_runner(run_line);
+	ss::set_command_runner(run_tokens);
+	ss::reset_options();
 
 	while(1) {	
-		
-		bool fg_param_present = true; // whether the user explicitly specifies foreground/background mode
-		bool run_in_fg = true; // run job in foreground/background mode
-		bool redir = false; // whether the user wants the output to be redirected
-
-		cur_dir = getcwd(cur_buf, 300);
 
-		cout << "Simple_Shell:" + cur_dir + "$ "; // prompt
-		getline(std::cin, command); // read in user input
+		if (interactive && source.empty()) {
+			cur_dir = getcwd(cur_buf, sizeof(cur_buf)) != nullptr ? cur_buf : "?";
+			ss::input_prompt("Simple_Shell:" + cur_dir + "$ "); // shown by readline
+		} else if (interactive) {
+			ss::input_prompt("> "); // the construct goes on
+		}
 
-		if(command.compare(exit) != 0) {
-			
-			if(command.empty()) {
-				continue; // empty command
+		if (!ss::read_command(command)) { // read in user input
+			if (!source.empty()) { // the input ended inside a construct
+				cerr << error << endl;
+				ss::last_status = EXIT_FAILURE;
+			}
+			if (interactive) {
+				cout << endl;
 			}
+			break; // end of input
+		}
 
-			tokenize(command, " ", tokens); // tokenize user input with space character as the delimiter
+		if (source.empty() && command.empty()) {
+			continue; // empty command
+		}
 
-			/* determine running mode: foreground or background */
-			if(tokens[0] == "bg") { 
-				run_in_fg = false;
-			} else {
-				if (tokens[0] != "fg") {
-					fg_param_present = false;
-				}
-			}
+		source += command;
+		source += '\n';
 
-			/* discard fg/bg specifier */
-			if (fg_param_present) {
-				tokens.erase(tokens.begin()); 
-			}
-			
-			/* determine if redirection is requested */
-			vector<string>::iterator iter;
+		ss::compile_result result = ss::compile(source, code, error);
 
-			iter = std::find(tokens.begin(), tokens.end(), ">");
-			if (iter != tokens.end()) {
-				redir = true;
-			}
+		if (result == ss::incomplete) {
+			continue; // read the rest of the construct
+		}
+
+		source.clear();
 
-			/* run the command */
-			run_command(tokens, run_in_fg, redir); 
-			
-			/* clear token vector for the next command */
-			tokens.clear(); 
-		
+		if (result == ss::malformed) {
+			cerr << error << endl;
+			ss::last_status = EXIT_FAILURE;
 		} else {
-			break; // user entered "exit"
+			ss::execute(code, stop_on_error);
 		}
-		
+
+		if (ss::exit_requested()) {
+			break; // the user entered exit
+		}
+
+		if (stop_on_error && ss::last_status != EXIT_SUCCESS) {
+			break;
+		}
+
 	}
 
-	cout << "Exited simple shell." << endl;
+	if (interactive) {
+		cout << "Exited simple shell." << endl;
+	}
 
-	return 0;
+	return ss::last_status;
 }
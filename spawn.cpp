@@ -0,0 +1,176 @@
+#include "spawn.h"
+#include "reaper.h"
+#include "pathcache.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <cerrno>
+
+namespace ss {
+
+void make_plan (const vector<string>& tokens, spawn_plan& plan) {
+
+	plan.argv.clear();
+	plan.argv.reserve(tokens.size() + 1);
+
+	for(vector<string>::const_iterator iter = tokens.cbegin(); iter != tokens.cend(); iter++) {
+		plan.argv.push_back(const_cast<char*>(iter -> c_str())); // prepare argument array
+	}
+
+	plan.argv.push_back(nullptr);
+	plan.exec_path = tokens.empty() ? string() : resolve_command(tokens[0]);
+	plan.in_fd = -1;
+	plan.out_fd = -1;
+	plan.actions.clear();
+	plan.pgid = -1;
+	plan.limits = nullptr;
+	plan.cgroup_fd = -1;
+	plan.cpus = nullptr;
+	plan.exec_errno = 0;
+
+}
+
+void block_sigchld (sigset_t& orig_mask) {
+
+	sigset_t chld_mask;
+	sigemptyset(&chld_mask);
+	sigaddset(&chld_mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &chld_mask, &orig_mask);
+
+}
+
+void restore_sigmask (const sigset_t& orig_mask) {
+
+	sigprocmask(SIG_SETMASK, &orig_mask, nullptr);
+
+}
+
+bool setup_child (spawn_plan& plan) {
+
+	if (plan.pgid != -1) {
+		setpgid(0, plan.pgid);
+	}
+
+	// join the cgroup before exec, so no memory is charged to the shell's
+	if (plan.cgroup_fd != -1 && write(plan.cgroup_fd, "0", 1) != 1) {
+		plan.exec_errno = errno;
+		return false;
+	}
+
+	if (plan.limits != nullptr && (plan.exec_errno = apply_limits(*plan.limits)) != 0) {
+		return false;
+	}
+
+	if (plan.cpus != nullptr && sched_setaffinity(0, sizeof(cpu_set_t), plan.cpus) != 0) {
+		plan.exec_errno = errno;
+		return false;
+	}
+
+	// pipe ends are close-on-exec, only their copies on stdin and stdout survive
+	if (plan.in_fd != -1) {
+		dup2(plan.in_fd, STDIN_FILENO);
+	}
+
+	if (plan.out_fd != -1) {
+		dup2(plan.out_fd, STDOUT_FILENO);
+	}
+
+	// the files were opened close-on-exec by the parent
+	for (vector<fd_action>::const_iterator iter = plan.actions.cbegin(); iter != plan.actions.cend(); iter++) {
+		dup2(iter -> source, iter -> fd);
+	}
+
+	return true;
+
+}
+
+/**
+* Close a descriptor of a plan, unless the plan set it up as one of the child's descriptors
+*/
+static void close_source (const spawn_plan& plan, int fd) {
+
+	if (fd <= STDERR_FILENO) {
+		return;
+	}
+
+	for (vector<fd_action>::const_iterator iter = plan.actions.cbegin(); iter != plan.actions.cend(); iter++) {
+		if (iter -> fd == fd) {
+			return;
+		}
+	}
+
+	close(fd);
+
+}
+
+void close_plan (const spawn_plan& plan) {
+
+	close_source(plan, plan.in_fd);
+	close_source(plan, plan.out_fd);
+	close_source(plan, plan.cgroup_fd);
+
+	// the capture's write end may be the source of both stdout and stderr; a second close just fails
+	for (vector<fd_action>::const_iterator iter = plan.actions.cbegin(); iter != plan.actions.cend(); iter++) {
+		close_source(plan, iter -> source);
+	}
+
+}
+
+/**
+* Runs in the vforked child: only async-signal-safe system calls,
+* no allocation and no writes to the parent's memory other than the plan's errno fields
+*/
+[[noreturn]] static void exec_child (spawn_plan& plan, const sigset_t& orig_mask) {
+
+	// the shell's handlers must not run in the child, which still shares the shell's memory
+	signal(SIGCHLD, SIG_DFL);
+	sigprocmask(SIG_SETMASK, &orig_mask, nullptr);
+
+	if (!setup_child(plan)) {
+		_exit(127);
+	}
+
+	execv(plan.exec_path.c_str(), plan.argv.data()); // already searched for, keeps the environment
+
+	plan.exec_errno = errno; // successful exec should not return
+	_exit(127);
+
+}
+
+pid_t spawn (spawn_plan& plan, const sigset_t& orig_mask) {
+
+	// keep every signal away from the child until it has reset the shell's handlers
+	sigset_t all_mask, chld_mask;
+	sigfillset(&all_mask);
+	sigprocmask(SIG_BLOCK, &all_mask, &chld_mask);
+
+	plan.fork_time = monotonic_now();
+
+	if (plan.exec_path.empty()) { // nothing to exec, do not pay for a fork
+		plan.exec_time = plan.fork_time;
+		plan.exec_errno = ENOENT;
+		sigprocmask(SIG_SETMASK, &chld_mask, nullptr);
+		return -1;
+	}
+
+	pid_t p = vfork();
+
+	if (p == 0) { // child
+		exec_child(plan, orig_mask);
+	}
+
+	plan.exec_time = monotonic_now(); // vfork only returns once the child has exec'd
+
+	sigprocmask(SIG_SETMASK, &chld_mask, nullptr); // back to SIGCHLD blocked
+
+	if (p > 0 && plan.exec_errno != 0) { // the child already exited, collect it here
+		waitpid(p, nullptr, 0);
+		return -1;
+	}
+
+	return p;
+
+}
+
+}
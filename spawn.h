@@ -0,0 +1,95 @@
+#ifndef _SPAWN_H_
+#define _SPAWN_H_
+
+#include <signal.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+#include "joblimits.h"
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* A dup2 call made in the child: source becomes fd
+*/
+struct fd_action {
+	int fd;
+	int source;
+};
+
+/**
+* Everything the child needs between vfork and exec.
+* The parent prepares the plan so that the child only has to issue system calls;
+* the child reports failures back through the plan, since it shares the parent's memory until exec
+*/
+struct spawn_plan {
+	vector<char*> argv;      // null-terminated argument vector, pointing into the caller's tokens
+	string exec_path;        // executable resolved from PATH, empty if there is none
+	int in_fd;               // descriptor to become stdin, or -1
+	int out_fd;              // descriptor to become stdout, or -1
+	vector<fd_action> actions; // redirections, applied in order after in_fd and out_fd
+	pid_t pgid;              // process group to join, 0 to lead a new one, -1 to stay in the shell's
+	const job_limits* limits; // limits to apply before exec, or nullptr
+	int cgroup_fd;           // cgroup.procs of the cgroup to join, or -1
+	const cpu_set_t* cpus;   // CPUs to run on, or nullptr to inherit the shell's
+	int exec_errno;          // set by the child if exec failed or a limit or the CPUs could not be applied
+	double fork_time;        // monotonic time just before vfork
+	double exec_time;        // monotonic time the parent resumed, i.e. the child exec'd
+};
+
+/**
+* Fill in a plan for running a command with the shell's stdin, stdout and process group.
+* The command name is resolved through the path cache here, in the parent
+* @param tokens The command name and its arguments, without any redirections
+* @param plan The plan to fill in; it refers to tokens, which must outlive it
+*/
+void make_plan (const vector<string>& tokens, spawn_plan& plan);
+
+/**
+* Block SIGCHLD so that a new child cannot be reaped before it is registered in ps
+* @param orig_mask Receives the signal mask in effect before the call
+*/
+void block_sigchld (sigset_t& orig_mask);
+
+/**
+* Restore the signal mask saved by block_sigchld
+* @param orig_mask The mask returned by block_sigchld
+*/
+void restore_sigmask (const sigset_t& orig_mask);
+
+/**
+* Apply a plan in a new child: join its process group and cgroup, apply its limits and CPUs,
+* then set up stdin, stdout and the redirections. Only makes async-signal-safe system calls,
+* so it runs between vfork and exec as well as in a forked child that runs shell code
+* @param plan The plan
+* @return false, with exec_errno set, if the cgroup, a limit or the CPUs could not be applied
+*/
+bool setup_child (spawn_plan& plan);
+
+/**
+* Close the descriptors a plan dup'd, in a child that set it up and runs shell code instead of exec'ing,
+* where close-on-exec never fires: in_fd, out_fd, the cgroup and the sources of the redirections
+* @param plan The plan, after setup_child
+*/
+void close_plan (const spawn_plan& plan);
+
+/**
+* Launch a command with vfork and execv of the resolved path.
+* A command that is not found anywhere in PATH fails with ENOENT in exec_errno without forking.
+* Must be called with SIGCHLD blocked. The parent resumes once the child has exec'd,
+* so the returned pid can be registered in ps before any SIGCHLD for it is delivered.
+* No pipe or semaphore is needed to hand the pid over
+* @param plan The prepared plan; its errno fields are updated by the child
+* @param orig_mask The signal mask the child should run with
+* @return The pid of the running child, or -1 if fork or exec failed
+*/
+pid_t spawn (spawn_plan& plan, const sigset_t& orig_mask);
+
+}
+
+#endif
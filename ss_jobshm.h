@@ -0,0 +1,89 @@
+#ifndef _SS_JOBSHM_H_
+#define _SS_JOBSHM_H_
+
+/**
+* The layout of the job table a shell mirrors into /dev/shm/simple_shell.<shell pid>,
+* for monitors that want to watch its jobs without talking to it.
+* The segment is a header followed by fixed-size records, one per job the shell retains.
+* The shell is the only writer; each record is guarded by a seqlock, so a reader copies it
+* with ss_jobshm_read and retries the rare copy that raced with an update.
+* Fields may only be appended, along with a new version number
+*/
+#include <stdint.h>
+#include <string.h>
+
+#define SS_JOBSHM_MAGIC   0x424a5353u /* "SSJB" */
+#define SS_JOBSHM_VERSION 1
+#define SS_JOBSHM_PREFIX  "simple_shell."
+
+/* states of a job */
+#define SS_JOB_RUNNING  0
+#define SS_JOB_EXITED   1
+#define SS_JOB_SIGNALED 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ss_jobshm_header {
+	uint32_t magic;       // SS_JOBSHM_MAGIC
+	uint32_t version;     // SS_JOBSHM_VERSION
+	uint32_t record_size; // sizeof(struct ss_jobshm_record)
+	uint32_t capacity;    // records the segment holds; it grows, so remap when this exceeds your mapping
+	uint32_t used;        // records [0, used) have been written at least once
+	int32_t shell_pid;    // the shell that owns the segment
+	uint64_t generation;  // bumped after every change, so a poller can skip an unchanged table
+};
+
+struct ss_jobshm_record {
+	uint32_t seq;       // seqlock sequence, odd while the shell writes the record
+	int32_t pid;        // pid of the job, or of its first stage; 0 if the record is free
+	uint64_t id;        // job number, unique within the shell
+	int32_t state;      // SS_JOB_RUNNING, SS_JOB_EXITED or SS_JOB_SIGNALED
+	int32_t status;     // exit code or signal number
+	int64_t start_ns;   // wall clock time the job was launched, in ns since the epoch
+	int64_t end_ns;     // wall clock time it was reaped, 0 while running
+	int64_t utime_us;   // resources used by the reaped processes of the job, from wait4
+	int64_t stime_us;
+	int64_t maxrss_kb;
+	int64_t minflt;
+	int64_t majflt;
+	int64_t nvcsw;
+	int64_t nivcsw;
+	uint32_t stages;    // number of processes in the job
+	char command[92];   // the command line, truncated, null-terminated
+};
+
+/**
+* Copy a record consistently
+* @param shared The record in the segment
+* @param copy Receives the record
+* @return 0 on success, -1 if the shell kept writing it (retry later)
+*/
+static inline int ss_jobshm_read (const struct ss_jobshm_record* shared, struct ss_jobshm_record* copy) {
+
+	for (int attempt = 0; attempt < 64; ++attempt) {
+
+		uint32_t before = __atomic_load_n(&shared -> seq, __ATOMIC_ACQUIRE);
+
+		if (before & 1) {
+			continue;
+		}
+
+		memcpy(copy, (const void*) shared, sizeof(*copy));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&shared -> seq, __ATOMIC_RELAXED) == before) {
+			return 0;
+		}
+	}
+
+	return -1;
+
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _SS_PLUGIN_H_
+#define _SS_PLUGIN_H_
+
+/**
+* The ABI of builtins loaded with enable -f. A plugin library exports, with C linkage,
+* one struct ss_plugin named <name>_builtin for every builtin it provides.
+* The shell only reads the fields below and never frees anything the plugin owns,
+* so new fields may only be appended along with a new version number
+*/
+#define SS_PLUGIN_ABI 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* Entry point of a builtin. It runs inside the shell with any redirections already applied
+* to descriptors 0, 1 and 2, and must not exit or keep pointers into argv
+* @param argc Number of arguments, including the builtin's name
+* @param argv The arguments, null-terminated
+* @return The exit status of the builtin
+*/
+typedef int (*ss_plugin_fn) (int argc, char* argv[]);
+
+struct ss_plugin {
+	int abi;           // SS_PLUGIN_ABI the plugin was compiled against
+	const char* name;  // the name it is invoked by; the shell uses the name it was enabled as, which picked the struct
+	const char* usage; // one line shown by enable
+	ss_plugin_fn run;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
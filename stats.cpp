@@ -0,0 +1,292 @@
+#include "stats.h"
+#include "cmds.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace ss {
+
+histogram::histogram () : samples(0), largest(0) {
+
+	memset(counts, 0, sizeof(counts));
+
+}
+
+/**
+* Bucket i holds samples up to 2^(i/4) microseconds
+*/
+static double bucket_limit (int i) {
+
+	return std::pow(2.0, i / 4.0) / 1e6;
+
+}
+
+void histogram::add (double seconds) {
+
+	double us = seconds * 1e6;
+	int i = us <= 1 ? 0 : static_cast<int>(std::ceil(4 * std::log2(us)));
+
+	if (i >= buckets) {
+		i = buckets - 1;
+	}
+
+	counts[i]++;
+	samples++;
+
+	if (seconds > largest) {
+		largest = seconds;
+	}
+
+}
+
+double histogram::percentile (double fraction) const {
+
+	if (samples == 0) {
+		return 0;
+	}
+
+	unsigned long rank = static_cast<unsigned long>(std::ceil(fraction * samples));
+	unsigned long seen = 0;
+
+	for (int i = 0; i < buckets; ++i) {
+		seen += counts[i];
+		if (seen >= rank && counts[i] > 0) {
+			return std::min(bucket_limit(i), largest);
+		}
+	}
+
+	return largest;
+
+}
+
+void histogram::write_json (std::ostream& out) const {
+
+	out << "{\"count\": " << samples << ", \"p50\": " << percentile(0.5) << ", \"p99\": " << percentile(0.99)
+	    << ", \"max\": " << largest << ", \"buckets\": [";
+
+	bool first = true;
+
+	for (int i = 0; i < buckets; ++i) {
+		if (counts[i] > 0) {
+			out << (first ? "" : ", ") << "{\"le\": " << bucket_limit(i) << ", \"count\": " << counts[i] << "}";
+			first = false;
+		}
+	}
+
+	out << "]}";
+
+}
+
+/**
+* Aggregates over every job reaped since the shell started or stats --reset
+*/
+static histogram exec_latency;
+static histogram wall_time;
+static histogram cpu_time;
+static unsigned long jobs_failed = 0;
+
+static double cpu_seconds (const process& entry) {
+
+	const struct rusage& usage = entry.usage;
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+
+}
+
+static bool failed (const process& entry) {
+
+	return entry.state > 0 || entry.exit_code != 0;
+
+}
+
+void record_job (const process& entry) {
+
+	if (entry.exec_latency >= 0) {
+		exec_latency.add(entry.exec_latency);
+	}
+
+	wall_time.add(entry.finished - entry.launched);
+	cpu_time.add(cpu_seconds(entry));
+
+	if (failed(entry)) {
+		jobs_failed++;
+	}
+
+	if (entry.timed) {
+		print_timing(cerr, entry);
+	}
+
+}
+
+/**
+* Describe how a job ended
+*/
+static string status_text (const process& entry) {
+
+	if (!entry.reaped) {
+		return "running";
+	}
+
+	if (entry.state > 0) {
+		return "signal " + std::to_string(entry.state);
+	}
+
+	return "exit " + std::to_string(entry.exit_code);
+
+}
+
+void print_timing (std::ostream& out, const process& entry) {
+
+	const struct rusage& usage = entry.usage;
+
+	out << std::fixed << std::setprecision(3)
+	    << "real " << entry.finished - entry.launched << "s"
+	    << "  user " << usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 << "s"
+	    << "  sys " << usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6 << "s"
+	    << std::setprecision(1)
+	    << "  fork-to-exec " << entry.exec_latency * 1e6 << "us"
+	    << "  " << status_text(entry) << endl;
+	out.unsetf(std::ios_base::floatfield);
+	out << std::setprecision(6);
+
+}
+
+/**
+* Print one aggregate line: count, p50, p99 and max in milliseconds
+*/
+static void print_histogram (std::ostream& out, const char* name, const histogram& h) {
+
+	out << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(3)
+	    << std::setw(10) << h.count()
+	    << std::setw(12) << h.percentile(0.5) * 1e3
+	    << std::setw(12) << h.percentile(0.99) * 1e3
+	    << std::setw(12) << h.max() * 1e3 << endl;
+	out.unsetf(std::ios_base::floatfield);
+	out << std::setprecision(6);
+
+}
+
+/**
+* Write a string as a JSON string literal
+*/
+static void write_json_string (std::ostream& out, const string& s) {
+
+	out << '"';
+
+	for (string::const_iterator c = s.cbegin(); c != s.cend(); c++) {
+		if (*c == '"' || *c == '\\') {
+			out << '\\' << *c;
+		} else if (static_cast<unsigned char>(*c) < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+			out << escaped;
+		} else {
+			out << *c;
+		}
+	}
+
+	out << '"';
+
+}
+
+static void write_json (std::ostream& out) {
+
+	out << "{\"jobs\": " << wall_time.count() << ", \"failed\": " << jobs_failed;
+	out << ", \"exec_latency\": ";
+	exec_latency.write_json(out);
+	out << ", \"wall_time\": ";
+	wall_time.write_json(out);
+	out << ", \"cpu_time\": ";
+	cpu_time.write_json(out);
+	out << ", \"retained_jobs\": [";
+
+	for (job_table::const_iterator iter = ps.cbegin(); iter != ps.cend(); iter++) {
+
+		string command;
+		for (vector<string>::const_iterator token = iter -> tokens.cbegin(); token != iter -> tokens.cend(); token++) {
+			command += (command.empty() ? "" : " ") + *token;
+		}
+
+		out << (iter == ps.cbegin() ? "" : ", ") << "{\"pid\": " << iter -> pid << ", \"command\": ";
+		write_json_string(out, command);
+		out << ", \"reaped\": " << (iter -> reaped ? "true" : "false")
+		    << ", \"exec_latency\": " << iter -> exec_latency;
+
+		if (iter -> reaped) {
+			out << ", \"wall_time\": " << iter -> finished - iter -> launched
+			    << ", \"cpu_time\": " << cpu_seconds(*iter)
+			    << ", \"signal\": " << iter -> state
+			    << ", \"exit_code\": " << iter -> exit_code;
+		}
+
+		out << "}";
+	}
+
+	out << "]}" << endl;
+
+}
+
+void stats (vector<string>& tokens, bool run_in_fg, bool redir) {
+
+	if (tokens.size() == 2 && tokens[1] == "--reset") {
+		exec_latency = histogram();
+		wall_time = histogram();
+		cpu_time = histogram();
+		jobs_failed = 0;
+		return;
+	}
+
+	if (tokens.size() == 3 && tokens[1] == "--json") {
+
+		std::ofstream file(tokens[2].c_str());
+
+		if (!file.is_open()) {
+			perror(tokens[2].c_str());
+			last_status = EXIT_FAILURE;
+			return;
+		}
+
+		write_json(file);
+		return;
+	}
+
+	bool list_jobs = tokens.size() == 2 && tokens[1] == "--jobs";
+
+	if (tokens.size() > 1 && !list_jobs) {
+		cerr << "Wrong arguments! \n";
+		cerr << "Correct form: stats [--jobs | --json <file> | --reset]\n";
+		last_status = EXIT_FAILURE;
+		return;
+	}
+
+	cout << "Jobs reaped: " << wall_time.count() << ", failed: " << jobs_failed << "\n\n";
+	cout << std::left << std::setw(14) << "(ms)" << std::right << std::setw(10) << "count"
+	     << std::setw(12) << "p50" << std::setw(12) << "p99" << std::setw(12) << "max" << endl;
+	print_histogram(cout, "fork-to-exec", exec_latency);
+	print_histogram(cout, "wall time", wall_time);
+	print_histogram(cout, "CPU time", cpu_time);
+
+	if (list_jobs) {
+
+		cout << endl;
+
+		for (job_table::const_iterator iter = ps.cbegin(); iter != ps.cend(); iter++) {
+			cout << "Pid: " << iter -> pid << "  ";
+			if (iter -> reaped) {
+				print_timing(cout, *iter);
+			} else {
+				cout << "running, fork-to-exec " << iter -> exec_latency * 1e6 << "us" << endl;
+			}
+		}
+	}
+
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+struct process;
+
+/**
+* A latency histogram with a fixed number of logarithmic buckets,
+* four per power of two starting at one microsecond, so memory does not grow with the number of samples
+*/
+class histogram {
+
+public:
+	static const int buckets = 128;
+
+	histogram ();
+
+	/**
+	* @param seconds The sample to add
+	*/
+	void add (double seconds);
+
+	/**
+	* @param fraction Between 0 and 1, e.g. 0.99
+	* @return Upper bound in seconds of the bucket holding the requested percentile, 0 if empty
+	*/
+	double percentile (double fraction) const;
+
+	unsigned long count () const { return samples; }
+	double max () const { return largest; }
+
+	/**
+	* Write the histogram as a JSON object with count, p50, p99, max and the non-empty buckets
+	*/
+	void write_json (std::ostream& out) const;
+
+private:
+	unsigned long counts[buckets];
+	unsigned long samples;
+	double largest;
+
+};
+
+/**
+* Add a reaped job to the aggregate statistics, and print its report if it was timed.
+* Called by the reaper for every reaped job
+* @param entry The job, with its finish time set
+*/
+void record_job (const process& entry);
+
+/**
+* Print the timing report of a job (the output of the time prefix)
+* @param out Where to print
+* @param entry A reaped job
+*/
+void print_timing (std::ostream& out, const process& entry);
+
+/**
+* Command that reports job statistics:
+* stats prints the aggregate fork-to-exec latency, wall time and CPU time,
+* stats --jobs also lists every job retained in ps,
+* stats --json <file> writes both as JSON, and stats --reset clears the aggregates
+* @param tokens A list of the command name and its arguments
+* @bool run_in_fg Specifier of whether the process runs in the foreground or not
+* @bool redir Specifier of whether the output should be redirected or not
+*/
+void stats (vector<string>& tokens, bool run_in_fg, bool redir = false);
+
+}
+
+#endif
@@ -0,0 +1,259 @@
+#include "subst.h"
+#include "shmjobs.h"
+#include "cmds.h"
+#include "spawn.h"
+#include "reaper.h"
+#include "lexer.h"
+#include "builtins.h"
+#include "redirect.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using std::cout;
+using std::cerr;
+
+namespace ss {
+
+/**
+* Size of the first read buffer of a capture
+*/
+static const size_t initial_capture = 64 * 1024;
+
+/**
+* Reads of a substitution's pipe per wakeup, so that the reaper keeps serving the capture rings
+*/
+static const int reads_per_wakeup = 16;
+
+/**
+* The output of the substitution being read
+*/
+struct pending_capture {
+	arena* out;
+	char* data;
+	size_t capacity;
+	size_t length;
+	bool done; // end of file
+};
+
+static pending_capture* reading = nullptr;
+
+static line_runner runner = nullptr;
+
+void set_line_runner (line_runner line) {
+
+	runner = line;
+
+}
+
+/**
+* Whether a command can be spawned directly rather than in a subshell:
+* a single external command without redirections, expansions or control flow
+*/
+static bool is_plain (const vector<word>& words) {
+
+	if (words.empty() || find_builtin(words[0].str()) != nullptr) {
+		return false;
+	}
+
+	for (vector<word>::const_iterator iter = words.cbegin(); iter != words.cend(); iter++) {
+		if (iter -> substitution || iter -> is("|") || iter -> is(";") || iter -> is("\n")
+		    || (!iter -> quoted && is_redirection(iter -> str()))) {
+			return false;
+		}
+	}
+
+	static const char* const shell_words[] = { "fg", "bg", "time", "exit", "if", "while", "until", "for", "break", "continue" };
+
+	for (size_t i = 0; i < sizeof(shell_words) / sizeof(shell_words[0]); ++i) {
+		if (words[0].is(shell_words[i])) {
+			return false;
+		}
+	}
+
+	return memchr(words[0].text, '=', words[0].length) == nullptr; // not an assignment
+
+}
+
+/**
+* Start the child of a capture with its stdout on write_end
+* @return The pid of the child, or -1
+*/
+static pid_t start_capture (const string& command, vector<string>& tokens, bool plain, int write_end) {
+
+	sigset_t orig_mask;
+	block_sigchld(orig_mask);
+
+	pid_t child;
+	spawn_plan plan;
+
+	if (plain) {
+
+		make_plan(tokens, plan);
+		plan.out_fd = write_end;
+		child = spawn(plan, orig_mask);
+
+		if (child == -1) {
+			errno = plan.exec_errno != 0 ? plan.exec_errno : errno;
+			perror(("Exec of " + tokens[0] + " in substitution failed").c_str());
+			last_status = 127;
+		}
+
+	} else {
+
+		child = fork();
+
+		if (child == 0) { // subshell
+
+			reaper_initialize();
+			shared_jobs_detach();
+			forget_jobs();
+			restore_sigmask(orig_mask);
+			dup2(write_end, STDOUT_FILENO);
+
+			runner(command);
+
+			cout.flush();
+			fflush(stdout);
+			_exit(last_status);
+		}
+
+		if (child == -1) {
+			perror("Fork of subshell failed");
+			last_status = EXIT_FAILURE;
+		}
+	}
+
+	if (child > 0) {
+		process& entry = add_process(child, tokens, true);
+		if (plain) {
+			record_launch(entry, plan);
+		}
+	}
+
+	restore_sigmask(orig_mask);
+
+	return child;
+
+}
+
+/**
+* Read what the substitution's child wrote, growing the buffer as it fills up.
+* Called by reaper_dispatch while capture sleeps in reaper_wait
+*/
+static void read_capture (int fd) {
+
+	pending_capture& state = *reading;
+
+	for (int i = 0; i < reads_per_wakeup; ++i) {
+
+		ssize_t n = read(fd, state.data + state.length, state.capacity - state.length);
+
+		if (n > 0) {
+			state.length += n;
+			if (state.length == state.capacity) {
+				state.data = state.out -> grow(state.data, state.capacity, state.capacity * 2);
+				state.capacity *= 2;
+			}
+			continue;
+		}
+
+		if (n == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (n == -1 && errno == EAGAIN) {
+			return;
+		}
+
+		if (n == -1) {
+			perror("Error reading substitution output");
+		}
+
+		unwatch_fd(fd);
+		state.done = true;
+		return;
+	}
+
+}
+
+const char* capture (const string& command, arena& out, size_t& length) {
+
+	length = 0;
+
+	arena scratch;
+	vector<word> words;
+
+	if (!lex(command.data(), command.size(), words, scratch, true) || words.empty()) {
+		return nullptr;
+	}
+
+	vector<string> tokens;
+	for (vector<word>::const_iterator iter = words.cbegin(); iter != words.cend(); iter++) {
+		tokens.push_back(iter -> str());
+	}
+
+	int pipefd[2];
+
+	if (pipe2(pipefd, O_CLOEXEC) == -1) {
+		perror("Error creating pipe for substitution");
+		return nullptr;
+	}
+
+	// the capture is not the job the user's options are for
+	job_options saved = options;
+	reset_options();
+
+	pid_t child = start_capture(command, tokens, is_plain(words), pipefd[1]);
+
+	options = saved;
+	close(pipefd[1]); // so the read ends when the child and its descendants are done
+
+	pending_capture state;
+	state.out = &out;
+	state.capacity = initial_capture;
+	state.data = out.allocate(state.capacity);
+	state.length = 0;
+	state.done = child <= 0;
+
+	pending_capture* outer = reading;
+	reading = &state;
+
+	// read in the reaper's epoll set, so that capture rings, restarts and reaping go on meanwhile
+	fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+
+	if (!state.done && !watch_fd(pipefd[0], read_capture)) {
+		perror("Error watching the substitution pipe");
+		fcntl(pipefd[0], F_SETFL, 0);
+		while (!state.done) {
+			read_capture(pipefd[0]);
+		}
+	}
+
+	while (!state.done) {
+		reaper_wait();
+	}
+
+	reading = outer;
+	close(pipefd[0]);
+
+	char* data = state.data;
+	length = state.length;
+
+	if (child > 0) {
+		wait_fg(child);
+	}
+
+	while (length > 0 && data[length - 1] == '\n') {
+		length--;
+	}
+
+	return data;
+
+}
+
+}
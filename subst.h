@@ -0,0 +1,41 @@
+#ifndef _SUBST_H_
+#define _SUBST_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+
+using std::vector;
+using std::string;
+
+namespace ss {
+
+/**
+* Runs a whole command line, used by forked subshells
+*/
+typedef void (*line_runner) (const string&);
+
+/**
+* Set the function subshells run their command line with
+* @param runner The shell's command line runner
+*/
+void set_line_runner (line_runner runner);
+
+/**
+* Run a command and collect everything it writes to stdout.
+* A plain external command is spawned directly; anything else, such as builtins, pipelines
+* or nested substitutions, runs in a forked subshell. Either way the child is registered in ps
+* and reaped through the reaper. The output is read into one allocation of the arena that grows
+* geometrically, so even very large outputs are copied a bounded number of times
+* @param command The command line
+* @param out Arena receiving the output
+* @param length Receives the length of the output, without trailing newlines
+* @return The output
+*/
+const char* capture (const string& command, arena& out, size_t& length);
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+/**
+* Print the jobs of running simple shells from their shared-memory job tables,
+* without signalling or talking to the shells.
+* Usage: ss_jobs [shell pid]...   (every shell found in /dev/shm if none is given)
+*/
+#include "ss_jobshm.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+* Print the table of one shell
+* @return false if it has no usable table
+*/
+static bool show_shell (const string& pid) {
+
+	string path = "/dev/shm/" SS_JOBSHM_PREFIX + pid;
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat st;
+
+	if (fd == -1 || fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(ss_jobshm_header)) {
+		fprintf(stderr, "ss_jobs: no job table for shell %s\n", pid.c_str());
+		if (fd != -1) {
+			close(fd);
+		}
+		return false;
+	}
+
+	// the size at open time bounds the records read; later growth is seen by the next run
+	void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (mapped == MAP_FAILED) {
+		perror("ss_jobs: mmap");
+		return false;
+	}
+
+	const ss_jobshm_header* header = static_cast<const ss_jobshm_header*>(mapped);
+
+	if (__atomic_load_n(&header -> magic, __ATOMIC_ACQUIRE) != SS_JOBSHM_MAGIC || header -> version != SS_JOBSHM_VERSION
+	    || header -> record_size != sizeof(ss_jobshm_record)) {
+		fprintf(stderr, "ss_jobs: %s has an unknown layout\n", path.c_str());
+		munmap(mapped, st.st_size);
+		return false;
+	}
+
+	bool alive = kill(header -> shell_pid, 0) == 0 || errno == EPERM;
+	size_t mapped_records = (st.st_size - sizeof(ss_jobshm_header)) / sizeof(ss_jobshm_record);
+	size_t used = __atomic_load_n(&header -> used, __ATOMIC_ACQUIRE);
+	const ss_jobshm_record* records = reinterpret_cast<const ss_jobshm_record*>(header + 1);
+
+	printf("shell %d%s\n", header -> shell_pid, alive ? "" : " (exited)");
+	printf("%8s %7s %-9s %8s %10s %10s %9s  %s\n", "PID", "JOB", "STATE", "ELAPSED", "USER", "SYS", "MAXRSS", "COMMAND");
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	int64_t now_ns = int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+
+	for (size_t i = 0; i < used && i < mapped_records; ++i) {
+
+		ss_jobshm_record r;
+
+		if (ss_jobshm_read(&records[i], &r) != 0 || r.pid == 0) {
+			continue;
+		}
+
+		char state[16];
+		if (r.state == SS_JOB_RUNNING) {
+			snprintf(state, sizeof(state), "running");
+		} else {
+			snprintf(state, sizeof(state), r.state == SS_JOB_EXITED ? "exit %d" : "sig %d", r.status);
+		}
+
+		double elapsed = ((r.end_ns != 0 ? r.end_ns : now_ns) - r.start_ns) / 1e9;
+
+		printf("%8d %7llu %-9s %7.1fs %9.3fs %9.3fs %7lldkB  %s\n", r.pid, (unsigned long long) r.id, state, elapsed,
+		       r.utime_us / 1e6, r.stime_us / 1e6, (long long) r.maxrss_kb, r.command);
+	}
+
+	munmap(mapped, st.st_size);
+	return true;
+
+}
+
+int main (int argc, char* argv[]) {
+
+	vector<string> shells(argv + 1, argv + argc);
+
+	if (shells.empty()) {
+
+		DIR* dir = opendir("/dev/shm");
+		struct dirent* entry;
+		size_t prefix = strlen(SS_JOBSHM_PREFIX);
+
+		while (dir != nullptr && (entry = readdir(dir)) != nullptr) {
+			if (strncmp(entry -> d_name, SS_JOBSHM_PREFIX, prefix) == 0) {
+				shells.push_back(entry -> d_name + prefix);
+			}
+		}
+
+		if (dir != nullptr) {
+			closedir(dir);
+		}
+	}
+
+	bool shown = true;
+
+	for (size_t i = 0; i < shells.size(); ++i) {
+		shown = show_shell(shells[i]) && shown;
+	}
+
+	return shown ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}